@@ -1,9 +1,25 @@
 #include "search_server.h"
+#include "index_snapshot.h"
+#include "segmented_search_server.h"
+#include "sharded_search_server.h"
+#include "process_queries.h"
+#include "query_executor.h"
+#include "async_search_server.h"
+#include "versioned_search_server.h"
+#include "remove_duplicates.h"
+#include "near_duplicates.h"
 #include "log_duration.h"
+#include "concurrent_flat_map.h"
+#include <atomic>
+#include <chrono>
 #include <execution>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <numeric>
 #include <random>
 #include <string>
+#include <thread>
 #include <vector>
 using namespace std;
 string GenerateWord(mt19937& generator, int max_length) {
@@ -37,11 +53,11 @@ string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int w
     }
     return query;
 }
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count, double minus_prob = 0) {
     vector<string> queries;
     queries.reserve(query_count);
     for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count, minus_prob));
     }
     return queries;
 }
@@ -56,16 +72,479 @@ void Test(string_view mark, const SearchServer& search_server, const vector<stri
     }
     cout << total_relevance << endl;
 }
+// Best time of a few runs over the queries in milliseconds
+template <typename ExecutionPolicy>
+double MeasureQueries(const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
+    double best_ms = numeric_limits<double>::infinity();
+    for (int run = 0; run < 3; ++run) {
+        const auto start = chrono::steady_clock::now();
+        for (const string_view query : queries) {
+            search_server.FindTopDocuments(policy, query);
+        }
+        best_ms = min(best_ms, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    return best_ms;
+}
+template <typename Tokenizer>
+void TestTokenizer(string_view mark, const vector<string>& texts, Tokenizer tokenizer) {
+    LOG_DURATION(mark);
+    vector<string_view> words;
+    size_t word_count = 0;
+    for (int repeat = 0; repeat < 10; ++repeat) {
+        for (const string& text : texts) {
+            words.clear();
+            // The result is used, so the validation is not optimized away
+            if (tokenizer(text, words)) {
+                word_count += words.size();
+            }
+        }
+    }
+    cout << word_count << endl;
+}
+// Counts queries whose results differ between exhaustive scoring and
+// dynamic pruning, which must give the same documents in the same order
+int CountPruningMismatches(SearchServer& search_server, const vector<string>& queries) {
+    int mismatch_count = 0;
+    for (const string_view query : queries) {
+        search_server.SetDynamicPruning(false);
+        const auto expected = search_server.FindTopDocuments(query);
+        const auto expected_par = search_server.FindTopDocuments(execution::par, query);
+        search_server.SetDynamicPruning(true);
+        const auto actual = search_server.FindTopDocuments(query);
+        const auto actual_par = search_server.FindTopDocuments(execution::par, query);
+        const auto same_ids = [](const vector<Document>& lhs, const vector<Document>& rhs) {
+            return equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const Document& l, const Document& r) {
+                return l.id == r.id;
+            });
+        };
+        if (!same_ids(expected, actual) || !same_ids(expected_par, actual_par) || !same_ids(expected, expected_par)) {
+            ++mismatch_count;
+        }
+    }
+    search_server.SetDynamicPruning(false);
+    return mismatch_count;
+}
+// Removals and re-adds leave champion lists holding documents less frequent
+// than the postings dropped from them earlier
+void TestPruningAfterChurn(const vector<string>& dictionary) {
+    mt19937 generator;
+    SearchServer search_server("and"s);
+    int id = 0;
+    for (int i = 0; i < 64; ++i) {
+        search_server.AddDocument(id++, "a a a x y"s, DocumentStatus::ACTUAL, {1});
+    }
+    for (int i = 0; i < 64; ++i) {
+        search_server.AddDocument(id++, "z z z x y"s, DocumentStatus::ACTUAL, {1});
+    }
+    search_server.AddDocument(id++, "a z"s, DocumentStatus::ACTUAL, {1});
+    for (int i = 0; i < 100; ++i) {
+        search_server.AddDocument(id++, "filler"s + to_string(i), DocumentStatus::ACTUAL, {1});
+    }
+    vector<int> removed_ids;
+    for (int i = 0; i < 32; ++i) {
+        removed_ids.push_back(i);
+        removed_ids.push_back(64 + i);
+    }
+    search_server.RemoveDocuments(removed_ids);
+    for (int i = 0; i < 10; ++i) {
+        search_server.AddDocument(id++, "a x x x x x x x x x"s, DocumentStatus::ACTUAL, {1});
+        search_server.AddDocument(id++, "z x x x x x x x x x"s, DocumentStatus::ACTUAL, {1});
+    }
+    int mismatch_count = CountPruningMismatches(search_server, {"a z"s, "a"s, "z"s, "x"s, "a x"s});
+    // Random churn over a small vocabulary
+    const vector<string> words(dictionary.begin(), dictionary.begin() + 20);
+    vector<int> ids;
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 200; ++i) {
+            search_server.AddDocument(id, GenerateQuery(generator, words, uniform_int_distribution(1, 10)(generator)),
+                                      DocumentStatus::ACTUAL, {uniform_int_distribution(0, 5)(generator)});
+            ids.push_back(id++);
+        }
+        shuffle(ids.begin(), ids.end(), generator);
+        search_server.RemoveDocuments(vector<int>(ids.end() - 150, ids.end()));
+        ids.resize(ids.size() - 150);
+        mismatch_count += CountPruningMismatches(search_server, GenerateQueries(generator, words, 10, 2, 0.1));
+    }
+    cout << "Dynamic pruning mismatches after churn: "s << mismatch_count << endl;
+}
+// Threads add to and erase a few hot keys at once. Every delta ends up either
+// in a value returned by erase or in the final map, so their sums must match.
+// Then every thread churns through many more distinct keys than the map was
+// sized for
+void TestConcurrentFlatMap() {
+    const int thread_count = max(4u, thread::hardware_concurrency());
+    const int operation_count = 200'000;
+    ConcurrentFlatMap<int, long long> counters(64);
+    vector<long long> added(thread_count);
+    vector<long long> erased(thread_count);
+    {
+        LOG_DURATION("ConcurrentFlatMap, "s + to_string(thread_count) + " threads"s);
+        vector<thread> threads;
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&, t] {
+                mt19937 generator(t);
+                for (int i = 0; i < operation_count; ++i) {
+                    const int key = uniform_int_distribution(0, 15)(generator);
+                    if (i % 10 == 0) {
+                        erased[t] += counters.erase(key).value_or(0);
+                    } else {
+                        counters.FetchAdd(key, 1);
+                        ++added[t];
+                    }
+                }
+                for (int i = 0; i < operation_count; ++i) {
+                    const int key = 1'000'000 * (t + 1) + i;
+                    counters.FetchAdd(key, 1);
+                    erased[t] += counters.erase(key).value_or(0);
+                    ++added[t];
+                }
+            });
+        }
+        for (thread& worker : threads) {
+            worker.join();
+        }
+    }
+    // Buckets are visited concurrently
+    atomic<long long> remaining = 0;
+    counters.ForEach(execution::par, [&remaining](int, long long value) {
+        remaining += value;
+    });
+    long long stored = 0;
+    for (const auto& [key, value] : counters.BuildOrdinaryMap(execution::par)) {
+        stored += value;
+    }
+    const long long lost = accumulate(added.begin(), added.end(), 0LL)
+                           - accumulate(erased.begin(), erased.end(), 0LL) - remaining;
+    cout << "ConcurrentFlatMap lost updates: "s << lost << ", map matches: "s << (stored == remaining) << endl;
+}
+// A repeated query is answered from the cache, any change of the index makes
+// the next call a miss with the new result, and the least recently used entry
+// is evicted when the cache is over capacity
+void TestQueryCache() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "black dog"s, DocumentStatus::ACTUAL, {2});
+    search_server.SetQueryCacheCapacity(2);
+    const auto ids = [](const vector<Document>& documents) {
+        vector<int> result;
+        for (const Document& document : documents) {
+            result.push_back(document.id);
+        }
+        return result;
+    };
+    bool ok = true;
+    const auto expect = [&ok](bool condition, string_view what) {
+        if (!condition) {
+            cout << "Query cache check failed: "s << what << endl;
+            ok = false;
+        }
+    };
+    const QueryCacheStats start = search_server.GetQueryCacheStats();
+    const auto first = search_server.FindTopDocuments("cat"s);
+    const auto second = search_server.FindTopDocuments("cat"s);
+    QueryCacheStats stats = search_server.GetQueryCacheStats();
+    expect(stats.misses == start.misses + 1 && stats.hits == start.hits + 1, "repeated query is a hit"sv);
+    expect(ids(first) == vector{1} && ids(second) == ids(first), "hit returns the cached result"sv);
+
+    search_server.AddDocument(3, "cat cat"s, DocumentStatus::ACTUAL, {3});
+    const auto after_add = search_server.FindTopDocuments("cat"s);
+    const QueryCacheStats after_add_stats = search_server.GetQueryCacheStats();
+    expect(after_add_stats.misses == stats.misses + 1 && after_add_stats.hits == stats.hits,
+           "AddDocument invalidates the entry"sv);
+    expect(ids(after_add) == vector{3, 1}, "miss after AddDocument returns the new result"sv);
+
+    search_server.RemoveDocument(3);
+    const auto after_remove = search_server.FindTopDocuments("cat"s);
+    stats = search_server.GetQueryCacheStats();
+    expect(stats.misses == after_add_stats.misses + 1 && stats.hits == after_add_stats.hits,
+           "RemoveDocument invalidates the entry"sv);
+    expect(ids(after_remove) == vector{1}, "miss after RemoveDocument returns the new result"sv);
+
+    // "cat" is the least recently used of three entries in a cache of two
+    search_server.FindTopDocuments("dog"s);
+    search_server.FindTopDocuments("white"s);
+    const QueryCacheStats full_stats = search_server.GetQueryCacheStats();
+    expect(full_stats.evictions == stats.evictions + 1, "over capacity evicts an entry"sv);
+    search_server.FindTopDocuments("dog"s);
+    search_server.FindTopDocuments("white"s);
+    stats = search_server.GetQueryCacheStats();
+    expect(stats.hits == full_stats.hits + 2, "recent entries stay cached"sv);
+    search_server.FindTopDocuments("cat"s);
+    expect(search_server.GetQueryCacheStats().misses == stats.misses + 1, "LRU entry is the evicted one"sv);
+    cout << "Query cache checks passed: "s << ok << endl;
+}
+// Readers check that every version they pin holds the documents of one
+// point of the write sequence and does not change while held. The writer
+// adds document i and then removes document i - window_size, so a version
+// holds a contiguous range of ids whose rating is the id
+void TestVersionedSearchServer() {
+    const int document_count = 2'000;
+    const int window_size = 8;
+    VersionedSearchServer versioned_server("and"s);
+    atomic<bool> is_writing = true;
+    atomic<int> inconsistent_count = 0;
+    atomic<int> version_count = 0;
+    const auto check_version = [&](const SearchServer& version, int& last_id) {
+        if (version.GetDocumentCount() == 0) {
+            return last_id < 0;
+        }
+        const int first_id = *version.begin();
+        const int id = *prev(version.end());
+        const int size = id - first_id + 1;
+        if (id < last_id || size != version.GetDocumentCount()
+            || (first_id > 0 && size != window_size && size != window_size + 1)) {
+            return false;
+        }
+        for (const int document_id : version) {
+            if (version.GetDocumentRating(document_id) != document_id) {
+                return false;
+            }
+        }
+        last_id = id;
+        return version.FindTopDocuments("common"s).size() == min<size_t>(size, MAX_RESULT_DOCUMENT_COUNT);
+    };
+    vector<thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            int last_id = -1;
+            while (is_writing) {
+                const auto version = versioned_server.GetSnapshot();
+                const int count = version->GetDocumentCount();
+                bool is_consistent = check_version(*version, last_id);
+                this_thread::yield();
+                is_consistent = is_consistent && version->GetDocumentCount() == count;
+                inconsistent_count += !is_consistent;
+                ++version_count;
+            }
+        });
+    }
+    {
+        LOG_DURATION("VersionedSearchServer, 3 readers"s);
+        for (int id = 0; id < document_count; ++id) {
+            versioned_server.AddDocument(id, "common w"s + to_string(id), DocumentStatus::ACTUAL, {id});
+            if (id >= window_size) {
+                versioned_server.RemoveDocument(id - window_size);
+            }
+        }
+        is_writing = false;
+        for (thread& reader : readers) {
+            reader.join();
+        }
+    }
+    int last_id = -1;
+    const auto final_version = versioned_server.GetSnapshot();
+    const bool is_final_consistent = check_version(*final_version, last_id)
+                                     && final_version->GetDocumentCount() == window_size
+                                     && last_id == document_count - 1;
+    cout << "VersionedSearchServer inconsistent versions: "s << inconsistent_count << " of "s << version_count
+         << ", final version matches: "s << is_final_consistent << endl;
+}
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
 int main() {
     mt19937 generator;
     const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    TestPruningAfterChurn(dictionary);
+    TestConcurrentFlatMap();
+    TestQueryCache();
+    TestVersionedSearchServer();
     const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
     SearchServer search_server(dictionary[0]);
-    for (size_t i = 0; i < documents.size(); ++i) {
-        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    {
+        LOG_DURATION("AddDocument"s);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    {
+        vector<NewDocument> new_documents;
+        new_documents.reserve(documents.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            new_documents.push_back({static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3}});
+        }
+        SearchServer batch_server(dictionary[0]);
+        LOG_DURATION("AddDocuments, par"s);
+        batch_server.AddDocuments(execution::par, new_documents);
     }
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
+    {
+        const auto long_documents = GenerateQueries(generator, dictionary, 1'000, 2'000);
+        TestTokenizer("SplitIntoWords, find"s, long_documents, [](string_view text, vector<string_view>& words) {
+            words = SplitIntoWords(text);
+            return all_of(words.begin(), words.end(), [](string_view word) {
+                return none_of(word.begin(), word.end(), [](char c) {
+                    return c >= '\0' && c < ' ';
+                });
+            });
+        });
+        TestTokenizer("SplitIntoWords, scalar"s, long_documents, [](string_view text, vector<string_view>& words) {
+            return SplitIntoWordsScalar(text, words);
+        });
+        TestTokenizer("SplitIntoWords, simd"s, long_documents, [](string_view text, vector<string_view>& words) {
+            return SplitIntoWords(text, words);
+        });
+    }
     TEST(seq);
     TEST(par);
+    search_server.SetDynamicPruning(true);
+    Test("seq, dynamic pruning"s, search_server, queries, execution::seq);
+    Test("par, dynamic pruning"s, search_server, queries, execution::par);
+    search_server.SetDynamicPruning(false);
+    {
+        const auto one_word_queries = GenerateQueries(generator, dictionary, 1'000, 1);
+        Test("seq, one word"s, search_server, one_word_queries, execution::seq);
+        search_server.SetDynamicPruning(true);
+        Test("seq, one word, champion lists"s, search_server, one_word_queries, execution::seq);
+        search_server.SetDynamicPruning(false);
+    }
+    {
+        const auto minus_queries = GenerateQueries(generator, dictionary, 100, 70, 0.3);
+        Test("seq, minus words"s, search_server, minus_queries, execution::seq);
+        Test("par, minus words"s, search_server, minus_queries, execution::par);
+    }
+    {
+        const vector<int> document_ids(search_server.begin(), search_server.end());
+        size_t word_count = 0;
+        {
+            LOG_DURATION("MatchDocument, one by one"s);
+            for (int id : document_ids) {
+                word_count += get<0>(search_server.MatchDocument(queries[0], id)).size();
+            }
+        }
+        LOG_DURATION("MatchDocuments, par"s);
+        for (const auto& [words, status] : search_server.MatchDocuments(execution::par, queries[0], document_ids)) {
+            word_count -= words.size();
+        }
+        cout << word_count << endl;
+    }
+    {
+        SearchServer duplicated_server(dictionary[0]);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            duplicated_server.AddDocument(2 * i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            duplicated_server.AddDocument(2 * i + 1, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        LOG_DURATION("RemoveDuplicates, par"s);
+        cout << RemoveDuplicates(execution::par, duplicated_server).size() << endl;
+    }
+    {
+        SearchServer one_by_one_server(dictionary[0]);
+        SearchServer batch_server(dictionary[0]);
+        vector<int> expired_ids;
+        for (size_t i = 0; i < documents.size(); ++i) {
+            one_by_one_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            batch_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            if (i % 3 == 0) {
+                expired_ids.push_back(i);
+            }
+        }
+        {
+            LOG_DURATION("RemoveDocument, one by one"s);
+            for (int id : expired_ids) {
+                one_by_one_server.RemoveDocument(id);
+            }
+        }
+        LOG_DURATION("RemoveDocuments, par"s);
+        batch_server.RemoveDocuments(execution::par, expired_ids);
+    }
+    {
+        LOG_DURATION("FindNearDuplicates, par"s);
+        cout << FindNearDuplicates(execution::par, search_server).size() << endl;
+    }
+    {
+        SegmentedSearchServer segmented_server(dictionary[0]);
+        {
+            LOG_DURATION("SegmentedSearchServer, AddDocument"s);
+            for (size_t i = 0; i < documents.size(); ++i) {
+                segmented_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            }
+            segmented_server.Flush();
+        }
+        LOG_DURATION("SegmentedSearchServer, par"s);
+        double total_relevance = 0;
+        for (const string_view query : queries) {
+            for (const auto& document : segmented_server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL)) {
+                total_relevance += document.relevance;
+            }
+        }
+        cout << total_relevance << endl;
+    }
+    {
+        const auto batch_queries = GenerateQueries(generator, dictionary, 1'000, 10);
+        {
+            LOG_DURATION("ProcessQueriesJoined"s);
+            cout << ProcessQueriesJoined(search_server, batch_queries).size() << endl;
+        }
+        QueryExecutor executor;
+        LOG_DURATION("QueryExecutor, "s + to_string(executor.GetThreadCount()) + " threads"s);
+        cout << executor.ProcessQueriesJoined(search_server, batch_queries).documents.size() << endl;
+    }
+    {
+        const auto batch_queries = GenerateQueries(generator, dictionary, 1'000, 10);
+        LOG_DURATION("AsyncSearchServer"s);
+        AsyncSearchServer async_server(search_server);
+        vector<future<vector<Document>>> results;
+        results.reserve(batch_queries.size());
+        for (const string& query : batch_queries) {
+            results.push_back(async_server.SubmitFindTopDocuments(query));
+        }
+        size_t document_count = 0;
+        for (auto& documents : results) {
+            document_count += documents.get().size();
+        }
+        cout << document_count << endl;
+    }
+    {
+        ShardedSearchServer sharded_server(dictionary[0]);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            sharded_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        LOG_DURATION("ShardedSearchServer, "s + to_string(sharded_server.GetShardCount()) + " shards"s);
+        double total_relevance = 0;
+        for (const string_view query : queries) {
+            for (const auto& document : sharded_server.FindTopDocuments(query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        cout << total_relevance << endl;
+    }
+    {
+        const auto plain_usage = search_server.GetMemoryUsage();
+        SearchServer compressed_server(dictionary[0]);
+        compressed_server.SetPostingCompression(true);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            compressed_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        const auto compressed_usage = compressed_server.GetMemoryUsage();
+        cout << "Bytes per posting: plain "s << plain_usage.GetBytesPerPosting()
+             << ", compressed "s << compressed_usage.GetBytesPerPosting() << endl;
+        Test("seq, compressed postings"s, compressed_server, queries, execution::seq);
+        Test("par, compressed postings"s, compressed_server, queries, execution::par);
+    }
+    {
+        LOG_DURATION("SaveSnapshot"s);
+        search_server.SaveSnapshot("search_index.snapshot"s);
+    }
+    {
+        LOG_DURATION("IndexSnapshot"s);
+        const IndexSnapshot snapshot("search_index.snapshot"s);
+        double total_relevance = 0;
+        for (const string_view query : queries) {
+            for (const auto& document : snapshot.FindTopDocuments(query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        cout << total_relevance << endl;
+    }
+    const size_t max_worker_count = thread::hardware_concurrency();
+    if (max_worker_count <= 1) {
+        cout << "par vs seq: one hardware thread, speedup does not apply"s << endl;
+        return 0;
+    }
+    const double seq_ms = MeasureQueries(search_server, queries, execution::seq);
+    cout << "seq: "s << seq_ms << " ms"s << endl;
+    for (size_t worker_count = 1; worker_count <= max_worker_count; ++worker_count) {
+        search_server.SetParallelWorkerCount(worker_count);
+        const double par_ms = MeasureQueries(search_server, queries, execution::par);
+        cout << "par, "s << worker_count << " workers: "s << par_ms << " ms, speedup over seq "s
+             << seq_ms / par_ms << endl;
+    }
 }
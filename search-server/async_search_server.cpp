@@ -0,0 +1,151 @@
+#include "async_search_server.h"
+#include <algorithm>
+#include <execution>
+#include <memory>
+#include <utility>
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer &search_server,
+		size_t queue_capacity, size_t thread_count) :
+		search_server_(search_server), queue_capacity_(
+				std::max<size_t>(1, queue_capacity)) {
+	thread_count = std::max<size_t>(1, thread_count);
+	threads_.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; ++i) {
+		threads_.emplace_back(&AsyncSearchServer::Work, this);
+	}
+}
+
+AsyncSearchServer::~AsyncSearchServer() {
+	{
+		std::lock_guard guard(mutex_);
+		stopping_ = true;
+	}
+	not_empty_.notify_all();
+	for (std::thread &thread : threads_) {
+		thread.join();
+	}
+}
+
+std::future<std::vector<Document>> AsyncSearchServer::SubmitFindTopDocuments(
+		std::string_view raw_query, DocumentStatus status,
+		std::optional<Clock::time_point> deadline) {
+	auto promise = std::make_shared<std::promise<std::vector<Document>>>();
+	auto result = promise->get_future();
+	SubmitFindTopDocuments(raw_query, status,
+			[promise](std::vector<Document> documents,
+					std::exception_ptr exception) {
+				if (exception) {
+					promise->set_exception(exception);
+				} else {
+					promise->set_value(std::move(documents));
+				}
+			}, deadline);
+	return result;
+}
+
+void AsyncSearchServer::SubmitFindTopDocuments(std::string_view raw_query,
+		DocumentStatus status, Callback callback,
+		std::optional<Clock::time_point> deadline) {
+	Request request { std::string(raw_query), status, deadline, std::move(
+			callback), MakeBatchKey(raw_query) };
+	std::unique_lock lock(mutex_);
+	not_full_.wait(lock, [this] {
+		return requests_.size() < queue_capacity_;
+	});
+	requests_.push_back(std::move(request));
+	lock.unlock();
+	not_empty_.notify_one();
+}
+
+void AsyncSearchServer::Work() {
+	std::vector<Request> batch;
+	// Keeps the reference to the first request valid while the batch grows
+	batch.reserve(MAX_BATCH_SIZE);
+	while (true) {
+		{
+			std::unique_lock lock(mutex_);
+			not_empty_.wait(lock, [this] {
+				return stopping_ || !requests_.empty();
+			});
+			if (requests_.empty()) {
+				return;
+			}
+			batch.clear();
+			batch.push_back(std::move(requests_.front()));
+			requests_.pop_front();
+			const Request &first = batch.front();
+			for (auto it = requests_.begin();
+					it != requests_.end() && batch.size() < MAX_BATCH_SIZE;) {
+				if (it->status == first.status
+						&& it->batch_key == first.batch_key) {
+					batch.push_back(std::move(*it));
+					it = requests_.erase(it);
+				} else {
+					++it;
+				}
+			}
+		}
+		not_full_.notify_all();
+		AnswerBatch(batch);
+	}
+}
+
+void AsyncSearchServer::AnswerBatch(std::vector<Request> &batch) const {
+	std::vector<char> is_expired(batch.size());
+	size_t waiting_count = batch.size();
+	// Marks the requests whose deadline has passed and returns true when no
+	// request is left waiting. It runs as the stop condition of the search,
+	// so the expired requests are failed only after the search returns and
+	// callbacks never run inside it
+	const auto expire_requests = [&] {
+		const Clock::time_point now = Clock::now();
+		for (size_t i = 0; i < batch.size(); ++i) {
+			if (!is_expired[i] && batch[i].deadline
+					&& now >= *batch[i].deadline) {
+				is_expired[i] = true;
+				--waiting_count;
+			}
+		}
+		return waiting_count == 0;
+	};
+	std::optional<std::vector<Document>> documents;
+	std::exception_ptr exception;
+	if (!expire_requests()) {
+		const bool has_deadline = std::any_of(batch.begin(), batch.end(),
+				[](const Request &request) {
+					return request.deadline.has_value();
+				});
+		const SearchStop stop(
+				has_deadline ?
+						std::function<bool()>(expire_requests) :
+						std::function<bool()>());
+		try {
+			documents = search_server_.TryFindTopDocuments(std::execution::seq,
+					batch.front().raw_query, batch.front().status, stop);
+		} catch (...) {
+			exception = std::current_exception();
+		}
+		expire_requests();
+	}
+	for (size_t i = 0; i < batch.size(); ++i) {
+		if (is_expired[i]) {
+			batch[i].callback( { },
+					std::make_exception_ptr(DeadlineExceeded()));
+		} else {
+			batch[i].callback(documents ? *documents : std::vector<Document> { },
+					exception);
+		}
+	}
+}
+
+std::string AsyncSearchServer::MakeBatchKey(std::string_view raw_query) {
+	std::vector<std::string_view> words = SplitIntoWords(raw_query);
+	std::sort(words.begin(), words.end());
+	words.erase(std::unique(words.begin(), words.end()), words.end());
+	std::string key;
+	for (std::string_view word : words) {
+		key += word;
+		key += ' ';
+	}
+	return key;
+}
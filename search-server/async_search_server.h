@@ -0,0 +1,86 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "search_server.h"
+
+// Reported to requests whose deadline passes before they are answered
+class DeadlineExceeded : public std::runtime_error {
+public:
+	DeadlineExceeded() :
+			std::runtime_error("Search deadline exceeded") {
+	}
+};
+
+// Answers FindTopDocuments requests on its own threads, so that callers do
+// not wait for them. Submitting blocks while queue_capacity requests are
+// waiting. A worker takes the oldest request together with the queued ones
+// that have the same words and status, scores them once and answers all of
+// them. Searches go through the query cache of the server. A request fails
+// with DeadlineExceeded once its own deadline passes, checked between posting
+// lists and windows of documents, and the search is abandoned once none of
+// its requests is left waiting.
+class AsyncSearchServer {
+public:
+	using Clock = std::chrono::steady_clock;
+	// Gets either the documents or the exception thrown by the search. Runs on
+	// a worker thread and must not throw
+	using Callback = std::function<void(std::vector<Document> documents,
+			std::exception_ptr exception)>;
+
+	static constexpr size_t DEFAULT_QUEUE_CAPACITY = 1024;
+	// Largest number of requests answered by one search
+	static constexpr size_t MAX_BATCH_SIZE = 64;
+
+	explicit AsyncSearchServer(const SearchServer &search_server,
+			size_t queue_capacity = DEFAULT_QUEUE_CAPACITY,
+			size_t thread_count = std::max(1u,
+					std::thread::hardware_concurrency()));
+
+	// Answers all submitted requests before returning
+	~AsyncSearchServer();
+
+	std::future<std::vector<Document>> SubmitFindTopDocuments(
+			std::string_view raw_query,
+			DocumentStatus status = DocumentStatus::ACTUAL,
+			std::optional<Clock::time_point> deadline = std::nullopt);
+
+	void SubmitFindTopDocuments(std::string_view raw_query,
+			DocumentStatus status, Callback callback,
+			std::optional<Clock::time_point> deadline = std::nullopt);
+
+private:
+	struct Request {
+		std::string raw_query;
+		DocumentStatus status;
+		std::optional<Clock::time_point> deadline;
+		Callback callback;
+		// Sorted distinct words of the query, equal for requests that may
+		// share a search
+		std::string batch_key;
+	};
+
+	const SearchServer &search_server_;
+	const size_t queue_capacity_;
+	std::mutex mutex_;
+	std::condition_variable not_empty_;
+	std::condition_variable not_full_;
+	std::deque<Request> requests_;
+	bool stopping_ = false;
+	std::vector<std::thread> threads_;
+
+	void Work();
+	// Runs one search for requests sharing the batch key
+	void AnswerBatch(std::vector<Request> &batch) const;
+	static std::string MakeBatchKey(std::string_view raw_query);
+};
@@ -0,0 +1,36 @@
+#include "champion_list.h"
+#include <algorithm>
+
+void ChampionList::Insert(int document_index, double term_freq) {
+	if (champions_.size() == CAPACITY) {
+		if (term_freq <= champions_.back().term_freq) {
+			outside_bound_ = std::max(outside_bound_, term_freq);
+			return;
+		}
+		outside_bound_ = std::max(outside_bound_, champions_.back().term_freq);
+		champions_.pop_back();
+	}
+	// Goes after the champions of the same frequency
+	const auto position = std::upper_bound(champions_.begin(),
+			champions_.end(), term_freq,
+			[](double freq, const Champion &champion) {
+				return freq > champion.term_freq;
+			});
+	champions_.insert(position, { document_index, term_freq });
+}
+
+void ChampionList::Remove(const int *begin, const int *end) {
+	champions_.erase(std::remove_if(champions_.begin(), champions_.end(),
+			[begin, end](const Champion &champion) {
+				return std::binary_search(begin, end, champion.document_index);
+			}), champions_.end());
+}
+
+void ChampionList::Clear() {
+	champions_.clear();
+	outside_bound_ = 0.0;
+}
+
+size_t ChampionList::GetMemoryUsage() const {
+	return champions_.capacity() * sizeof(Champion);
+}
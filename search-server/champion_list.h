@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Documents of one term with the largest term frequencies, most frequent
+// first. Every posting of the term left out of the list has a term frequency
+// not greater than GetOutsideBound(), so a query answered by the listed
+// documents alone does not need to read the postings. Removals keep the
+// outside bound and a list that is not full takes any posting, so the listed
+// documents may be less frequent than the bound: a bound on the postings
+// from some position of the list on is the larger of the two.
+class ChampionList {
+public:
+	static constexpr size_t CAPACITY = 64;
+
+	struct Champion {
+		int document_index;
+		double term_freq;
+	};
+
+	// Offers a posting of the term, which is kept if it is one of the
+	// CAPACITY most frequent ones
+	void Insert(int document_index, double term_freq);
+
+	// Drops the documents in [begin, end), which is sorted. The outside bound
+	// is kept, as it stays an upper bound
+	void Remove(const int *begin, const int *end);
+
+	void Clear();
+
+	// Removals left less than half of the list while some postings are
+	// outside it, so it should be rebuilt from the postings
+	bool IsDepleted() const {
+		return champions_.size() < CAPACITY / 2 && outside_bound_ > 0.0;
+	}
+
+	const std::vector<Champion>& GetChampions() const {
+		return champions_;
+	}
+
+	// Zero when every posting is in the list
+	double GetOutsideBound() const {
+		return outside_bound_;
+	}
+
+	// Upper bound of the term frequency of the postings other than the first
+	// position champions
+	double GetBoundAfter(size_t position) const {
+		return position < champions_.size() ?
+				std::max(champions_[position].term_freq, outside_bound_) :
+				outside_bound_;
+	}
+
+	// Upper bound of the term frequency over all the postings
+	double GetMaxTermFreq() const {
+		return GetBoundAfter(0);
+	}
+
+	size_t GetMemoryUsage() const;
+
+private:
+	std::vector<Champion> champions_;
+	double outside_bound_ = 0.0;
+};
@@ -0,0 +1,151 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <execution>
+#include <map>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace std::string_literals;
+
+// Hash map of integer keys to arithmetic values, sized up front for the
+// expected number of keys. Keys are spread over a flat array of buckets, each
+// guarded by its own spinlock and holding its items in a contiguous array, so
+// updates of keys in different buckets never contend and no update takes a
+// mutex or allocates a tree node. Buckets are padded to a cache line, so
+// threads updating neighbouring buckets do not share one.
+//
+// Erase moves the last item of the bucket into the freed place, so storage of
+// erased keys is reused by the next keys of the bucket and insert/erase churn
+// never runs out of room. A key erased and added again by several threads at
+// once gets all of their deltas.
+template <typename Key, typename Value>
+class ConcurrentFlatMap {
+public:
+    static_assert(std::is_integral_v<Key>, "ConcurrentFlatMap supports only integer keys"s);
+    static_assert(std::is_arithmetic_v<Value>, "ConcurrentFlatMap supports only arithmetic values"s);
+
+    explicit ConcurrentFlatMap(size_t expected_key_count)
+        : buckets_(RoundUpToPowerOfTwo(std::max<size_t>(expected_key_count / ITEMS_PER_BUCKET, 1)))
+        , mask_(buckets_.size() - 1) {
+        for (Bucket& bucket : buckets_) {
+            bucket.items.reserve(ITEMS_PER_BUCKET);
+        }
+    }
+
+    // Adds delta to the value of key, inserting the key with a zero value first
+    // if needed. Returns the previous value
+    Value FetchAdd(const Key& key, Value delta) {
+        Bucket& bucket = GetBucket(key);
+        Lock lock(bucket);
+        for (auto& [item_key, value] : bucket.items) {
+            if (item_key == key) {
+                const Value previous = value;
+                value += delta;
+                return previous;
+            }
+        }
+        bucket.items.emplace_back(key, delta);
+        return Value{};
+    }
+
+    // Returns the value of the erased key, or nothing if there was no such key
+    std::optional<Value> erase(const Key& key) {
+        Bucket& bucket = GetBucket(key);
+        Lock lock(bucket);
+        auto& items = bucket.items;
+        for (auto it = items.begin(); it != items.end(); ++it) {
+            if (it->first == key) {
+                const Value value = it->second;
+                *it = items.back();
+                items.pop_back();
+                return value;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Calls func(key, value) for every stored key. Buckets are split between
+    // workers of the execution policy, and func is called with the lock of the
+    // bucket held
+    template <typename ExecutionPolicy, typename Func>
+    void ForEach(const ExecutionPolicy& policy, Func func) const {
+        std::for_each(policy, buckets_.begin(), buckets_.end(), [&func](const Bucket& bucket) {
+            Lock lock(bucket);
+            for (const auto& [key, value] : bucket.items) {
+                func(key, value);
+            }
+        });
+    }
+
+    template <typename ExecutionPolicy>
+    std::map<Key, Value> BuildOrdinaryMap(const ExecutionPolicy& policy) const {
+        // Buckets are copied out in parallel, and only the tree is built by
+        // one thread
+        std::vector<std::vector<std::pair<Key, Value>>> bucket_items(buckets_.size());
+        std::transform(policy, buckets_.begin(), buckets_.end(), bucket_items.begin(), [](const Bucket& bucket) {
+            Lock lock(bucket);
+            return bucket.items;
+        });
+        std::map<Key, Value> result;
+        for (const auto& items : bucket_items) {
+            result.insert(items.begin(), items.end());
+        }
+        return result;
+    }
+
+    std::map<Key, Value> BuildOrdinaryMap() const {
+        return BuildOrdinaryMap(std::execution::seq);
+    }
+
+private:
+    // Average number of keys per bucket at the expected key count
+    static constexpr size_t ITEMS_PER_BUCKET = 2;
+
+    struct alignas(64) Bucket {
+        mutable std::atomic_flag locked = ATOMIC_FLAG_INIT;
+        std::vector<std::pair<Key, Value>> items;
+    };
+
+    class Lock {
+    public:
+        explicit Lock(const Bucket& bucket)
+            : bucket_(bucket) {
+            while (bucket_.locked.test_and_set(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+
+        ~Lock() {
+            bucket_.locked.clear(std::memory_order_release);
+        }
+
+        Lock(const Lock&) = delete;
+        Lock& operator=(const Lock&) = delete;
+
+    private:
+        const Bucket& bucket_;
+    };
+
+    static size_t RoundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    Bucket& GetBucket(const Key& key) {
+        uint64_t x = static_cast<uint64_t>(key) + 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return buckets_[(x ^ (x >> 31)) & mask_];
+    }
+
+    std::vector<Bucket> buckets_;
+    size_t mask_;
+};
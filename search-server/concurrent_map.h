@@ -37,7 +37,7 @@ public:
         return {key, bucket};
     }
     void erase(const Key &key) {
-        int index = static_cast<uint64_t>(key) % buckets_.size();
+        const size_t index = static_cast<uint64_t>(key) % buckets_.size();
     	std::lock_guard<std::mutex> g(buckets_[index].mutex);
     	buckets_[index].map.erase(key);
     }
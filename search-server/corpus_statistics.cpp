@@ -0,0 +1,46 @@
+#include "corpus_statistics.h"
+#include <cmath>
+
+void CorpusStatistics::AddDocument(
+		const WordFrequencies &word_frequencies) {
+	for (const auto& [word, _] : word_frequencies) {
+		const TermId term_id = dictionary_.Intern(word);
+		if (static_cast<size_t>(term_id) == document_freqs_.size()) {
+			document_freqs_.push_back(0);
+		}
+		++document_freqs_[term_id];
+	}
+	++document_count_;
+}
+
+void CorpusStatistics::RemoveDocument(
+		const WordFrequencies &word_frequencies) {
+	for (const auto& [word, _] : word_frequencies) {
+		--document_freqs_[dictionary_.Find(word)];
+	}
+	--document_count_;
+}
+
+int CorpusStatistics::GetDocumentCount() const {
+	return document_count_;
+}
+
+int CorpusStatistics::GetDocumentFreq(std::string_view word) const {
+	const TermId term_id = dictionary_.Find(word);
+	return term_id == TermDictionary::NO_TERM ? 0 : document_freqs_[term_id];
+}
+
+TermId CorpusStatistics::FindTermId(std::string_view word) const {
+	return dictionary_.Find(word);
+}
+
+std::string_view CorpusStatistics::FindWord(std::string_view word) const {
+	const TermId term_id = dictionary_.Find(word);
+	return term_id == TermDictionary::NO_TERM ?
+			std::string_view() : dictionary_.GetTerm(term_id);
+}
+
+double CorpusStatistics::ComputeInverseDocumentFreq(
+		std::string_view word) const {
+	return log(GetDocumentCount() * 1.0 / GetDocumentFreq(word));
+}
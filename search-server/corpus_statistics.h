@@ -0,0 +1,37 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include "term_dictionary.h"
+#include "word_frequencies.h"
+
+// Document frequencies of a corpus split between several SearchServer parts.
+// Parts score queries with the IDFs computed here, so relevance does not
+// depend on how the documents are spread over the parts.
+class CorpusStatistics {
+public:
+	// Takes the words of the document as returned by GetWordFrequencies
+	void AddDocument(const WordFrequencies &word_frequencies);
+
+	void RemoveDocument(
+			const WordFrequencies &word_frequencies);
+
+	int GetDocumentCount() const;
+
+	int GetDocumentFreq(std::string_view word) const;
+
+	// Words are numbered in the order they first appear, like SearchServer
+	// numbers its terms
+	TermId FindTermId(std::string_view word) const;
+
+	// Copy of the word kept for the lifetime of the statistics, or an empty
+	// view if no document has ever contained the word
+	std::string_view FindWord(std::string_view word) const;
+
+	// Same formula as SearchServer uses for its own documents
+	double ComputeInverseDocumentFreq(std::string_view word) const;
+
+private:
+	int document_count_ = 0;
+	TermDictionary dictionary_;
+	std::vector<int> document_freqs_;
+};
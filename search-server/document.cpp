@@ -10,3 +10,13 @@ std::ostream& operator<<(std::ostream &os, const Document &doc) {
 	os << "{ " << "document_id = " << doc.id << ", relevance = " << doc.relevance << ", rating = " << doc.rating << " }";
 	return os;
 }
+
+bool IsMoreRelevant(const Document &lhs, const Document &rhs) {
+	if (lhs.relevance != rhs.relevance) {
+		return lhs.relevance > rhs.relevance;
+	}
+	if (lhs.rating != rhs.rating) {
+		return lhs.rating > rhs.rating;
+	}
+	return lhs.id < rhs.id;
+}
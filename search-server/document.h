@@ -2,6 +2,7 @@
 #include <ostream>
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
+constexpr double COMPRASION_TOLERANCE = 1e-6;
 
 struct Document {
 	Document() = default;
@@ -19,3 +20,9 @@ enum class DocumentStatus {
 };
 
 std::ostream& operator<<(std::ostream &os, const Document &doc);
+
+// Orders documents by relevance, then by rating, the higher first, then by
+// id. The order is exact, so it is a strict weak ordering usable for sorting
+// and heaps. COMPRASION_TOLERANCE is only meant for comparing relevances in
+// output and checks.
+bool IsMoreRelevant(const Document &lhs, const Document &rhs);
@@ -0,0 +1,241 @@
+#include "index_snapshot.h"
+#include "string_processing.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+namespace {
+bool IsSectionValid(uint64_t offset, uint64_t count, size_t record_size,
+		uint64_t file_size) {
+	return offset % alignof(uint64_t) == 0 && offset <= file_size
+			&& count <= (file_size - offset) / record_size;
+}
+
+bool IsRangeValid(uint64_t first, uint64_t count, uint64_t size) {
+	return first <= size && count <= size - first;
+}
+}
+
+IndexSnapshot::IndexSnapshot(const std::string &path) :
+		path_(path) {
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Cannot open index snapshot "s + path);
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0
+			|| static_cast<size_t>(file_stat.st_size) < sizeof(SnapshotHeader)) {
+		close(fd);
+		throw std::runtime_error("Invalid index snapshot "s + path);
+	}
+	size_ = file_stat.st_size;
+	data_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data_ == MAP_FAILED) {
+		data_ = nullptr;
+		throw std::runtime_error("Cannot map index snapshot "s + path);
+	}
+
+	const char *base = static_cast<const char*>(data_);
+	header_ = reinterpret_cast<const SnapshotHeader*>(base);
+	if (std::memcmp(header_->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+			|| header_->version != SNAPSHOT_VERSION
+			|| header_->file_size != size_
+			|| !IsSectionValid(header_->documents_offset,
+					header_->document_count, sizeof(SnapshotDocument), size_)
+			|| !IsSectionValid(header_->terms_offset, header_->term_count,
+					sizeof(SnapshotTerm), size_)
+			|| !IsSectionValid(header_->postings_offset,
+					header_->posting_count, sizeof(SnapshotPosting), size_)
+			|| !IsSectionValid(header_->stop_words_offset,
+					header_->stop_word_count, sizeof(SnapshotString), size_)
+			|| !IsSectionValid(header_->chars_offset, header_->chars_size, 1,
+					size_)
+			|| header_->document_count > static_cast<uint64_t>(INT_MAX)) {
+		munmap(data_, size_);
+		data_ = nullptr;
+		throw std::runtime_error("Invalid index snapshot "s + path);
+	}
+	documents_ = reinterpret_cast<const SnapshotDocument*>(base
+			+ header_->documents_offset);
+	terms_ = reinterpret_cast<const SnapshotTerm*>(base + header_->terms_offset);
+	postings_ = reinterpret_cast<const SnapshotPosting*>(base
+			+ header_->postings_offset);
+	stop_words_ = reinterpret_cast<const SnapshotString*>(base
+			+ header_->stop_words_offset);
+	chars_ = base + header_->chars_offset;
+}
+
+IndexSnapshot::~IndexSnapshot() {
+	if (data_ != nullptr) {
+		munmap(data_, size_);
+	}
+}
+
+std::vector<Document> IndexSnapshot::FindTopDocuments(
+		std::string_view raw_query, DocumentStatus status,
+		size_t max_result_count) const {
+	return FindTopDocuments(raw_query,
+			[status](int document_id, DocumentStatus document_status,
+					int rating) {
+				return document_status == status;
+			}, max_result_count);
+}
+
+std::vector<Document> IndexSnapshot::FindTopDocuments(
+		std::string_view raw_query) const {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> IndexSnapshot::MatchDocument(
+		std::string_view raw_query, int document_id) const {
+	if (raw_query.empty()) {
+		throw std::invalid_argument("");
+	}
+	const SnapshotDocument *documents_end = documents_
+			+ header_->document_count;
+	const SnapshotDocument *document = std::lower_bound(documents_,
+			documents_end, document_id,
+			[](const SnapshotDocument &lhs, int id) {
+				return lhs.id < id;
+			});
+	if (document == documents_end || document->id != document_id) {
+		throw std::out_of_range("");
+	}
+	const int document_index = document - documents_;
+	const DocumentStatus status = static_cast<DocumentStatus>(document->status);
+	const Query query = ParseQuery(raw_query);
+	std::vector<std::string_view> matched_words;
+	for (const SnapshotTerm *term : query.minus_terms) {
+		if (HasPosting(*term, document_index)) {
+			return {matched_words, status};
+		}
+	}
+	for (const SnapshotTerm *term : query.plus_terms) {
+		if (HasPosting(*term, document_index)) {
+			matched_words.push_back(GetString(term->word));
+		}
+	}
+	std::sort(matched_words.begin(), matched_words.end());
+	return {matched_words, status};
+}
+
+int IndexSnapshot::GetDocumentCount() const {
+	return header_->document_count;
+}
+
+void IndexSnapshot::Verify() const {
+	for (const SnapshotTerm *term = terms_;
+			term != terms_ + header_->term_count; ++term) {
+		GetString(term->word);
+		CheckPostings(*term);
+	}
+	for (const SnapshotPosting *posting = postings_;
+			posting != postings_ + header_->posting_count; ++posting) {
+		CheckDocumentIndex(posting->document_index);
+	}
+	for (const SnapshotString *stop_word = stop_words_;
+			stop_word != stop_words_ + header_->stop_word_count; ++stop_word) {
+		GetString(*stop_word);
+	}
+}
+
+void IndexSnapshot::ThrowInvalid() const {
+	throw std::runtime_error("Invalid index snapshot "s + path_);
+}
+
+void IndexSnapshot::CheckPostings(const SnapshotTerm &term) const {
+	if (!IsRangeValid(term.first_posting, term.posting_count,
+			header_->posting_count)) {
+		ThrowInvalid();
+	}
+}
+
+std::string_view IndexSnapshot::GetString(const SnapshotString &str) const {
+	if (!IsRangeValid(str.offset, str.size, header_->chars_size)) {
+		ThrowInvalid();
+	}
+	return {chars_ + str.offset, str.size};
+}
+
+const SnapshotTerm* IndexSnapshot::FindTerm(std::string_view word) const {
+	const SnapshotTerm *terms_end = terms_ + header_->term_count;
+	const SnapshotTerm *term = std::lower_bound(terms_, terms_end, word,
+			[this](const SnapshotTerm &lhs, std::string_view rhs) {
+				return GetString(lhs.word) < rhs;
+			});
+	if (term == terms_end || GetString(term->word) != word) {
+		return nullptr;
+	}
+	return term;
+}
+
+bool IndexSnapshot::IsStopWord(std::string_view word) const {
+	const SnapshotString *stop_words_end = stop_words_
+			+ header_->stop_word_count;
+	const SnapshotString *stop_word = std::lower_bound(stop_words_,
+			stop_words_end, word,
+			[this](const SnapshotString &lhs, std::string_view rhs) {
+				return GetString(lhs) < rhs;
+			});
+	return stop_word != stop_words_end && GetString(*stop_word) == word;
+}
+
+IndexSnapshot::Query IndexSnapshot::ParseQuery(std::string_view text) const {
+	Query query;
+	thread_local std::vector<std::string_view> words;
+	words.clear();
+	if (!SplitIntoWords(text, words)) {
+		throw std::invalid_argument("Query word "s + std::string(words.back())
+				+ " is invalid");
+	}
+	for (std::string_view word : words) {
+		bool is_minus = false;
+		std::string_view data = word;
+		if (data[0] == '-') {
+			is_minus = true;
+			data = data.substr(1);
+		}
+		if (data.empty() || data[0] == '-') {
+			throw std::invalid_argument("Query word "s + std::string(word)
+					+ " is invalid");
+		}
+		if (IsStopWord(data)) {
+			continue;
+		}
+		const SnapshotTerm *term = FindTerm(data);
+		if (term == nullptr) {
+			continue;
+		}
+		CheckPostings(*term);
+		(is_minus ? query.minus_terms : query.plus_terms).push_back(term);
+	}
+	// Plus terms go in the order of their ids in the server, so relevance is
+	// summed in the same order and comes out bit for bit the same
+	for (auto *terms : { &query.plus_terms, &query.minus_terms }) {
+		std::sort(terms->begin(), terms->end(),
+				[](const SnapshotTerm *lhs, const SnapshotTerm *rhs) {
+					return lhs->term_id < rhs->term_id;
+				});
+		terms->erase(std::unique(terms->begin(), terms->end()), terms->end());
+	}
+	return query;
+}
+
+bool IndexSnapshot::HasPosting(const SnapshotTerm &term,
+		int document_index) const {
+	const SnapshotPosting *begin = postings_ + term.first_posting;
+	const SnapshotPosting *end = begin + term.posting_count;
+	const SnapshotPosting *it = std::lower_bound(begin, end, document_index,
+			[](const SnapshotPosting &posting, int index) {
+				return posting.document_index < index;
+			});
+	return it != end && it->document_index == document_index;
+}
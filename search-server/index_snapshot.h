@@ -0,0 +1,171 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include "document.h"
+#include "score_accumulator.h"
+#include "top_documents.h"
+
+// On-disk index layout written by SearchServer::SaveSnapshot. All sections are
+// arrays of the fixed-size records below, aligned to 8 bytes, so the file can
+// be used in place after mmap. Documents are stored in the order of their ids
+// and posting lists refer to documents by the position in that array. Terms
+// and stop words are sorted to allow binary search. Every term keeps its id
+// in the server, the order in which relevance is summed.
+constexpr char SNAPSHOT_MAGIC[8] = { 'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0' };
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t file_size;
+	uint64_t document_count;
+	uint64_t term_count;
+	uint64_t posting_count;
+	uint64_t stop_word_count;
+	uint64_t documents_offset;
+	uint64_t terms_offset;
+	uint64_t postings_offset;
+	uint64_t stop_words_offset;
+	uint64_t chars_offset;
+	uint64_t chars_size;
+};
+
+struct SnapshotDocument {
+	int32_t id;
+	int32_t rating;
+	int32_t status;
+	int32_t reserved;
+};
+
+struct SnapshotString {
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct SnapshotTerm {
+	SnapshotString word;
+	uint64_t first_posting;
+	uint64_t posting_count;
+	double inverse_document_freq;
+	uint64_t term_id;
+};
+
+struct SnapshotPosting {
+	int32_t document_index;
+	int32_t reserved;
+	double term_freq;
+};
+
+// Read-only search index served straight from a memory-mapped snapshot file.
+// Nothing is deserialized on open, and processes mapping the same file share
+// its pages in the page cache. Opening checks the header and the section
+// bounds only. Strings, posting ranges and document indexes are checked when
+// a query reads them, and a corrupt record makes the query throw
+// runtime_error. Verify checks the whole file up front. Returned string views
+// point into the mapping and stay valid while the snapshot is alive.
+class IndexSnapshot {
+public:
+	explicit IndexSnapshot(const std::string &path);
+	~IndexSnapshot();
+
+	IndexSnapshot(const IndexSnapshot&) = delete;
+	IndexSnapshot& operator=(const IndexSnapshot&) = delete;
+
+	template<typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query,
+			DocumentPredicate document_predicate,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query,
+			DocumentStatus status,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
+			std::string_view raw_query, int document_id) const;
+
+	int GetDocumentCount() const;
+
+	// Reads every record of the file, which touches all of its pages, and
+	// throws runtime_error for the first one out of bounds
+	void Verify() const;
+
+private:
+	struct Query {
+		std::vector<const SnapshotTerm*> plus_terms;
+		std::vector<const SnapshotTerm*> minus_terms;
+	};
+
+	std::string path_;
+	void* data_ = nullptr;
+	size_t size_ = 0;
+	const SnapshotHeader *header_ = nullptr;
+	const SnapshotDocument *documents_ = nullptr;
+	const SnapshotTerm *terms_ = nullptr;
+	const SnapshotPosting *postings_ = nullptr;
+	const SnapshotString *stop_words_ = nullptr;
+	const char *chars_ = nullptr;
+
+	[[noreturn]] void ThrowInvalid() const;
+	// Throws for a posting range or a document index out of bounds
+	void CheckPostings(const SnapshotTerm &term) const;
+	void CheckDocumentIndex(int document_index) const {
+		if (document_index < 0
+				|| static_cast<uint64_t>(document_index)
+						>= header_->document_count) {
+			ThrowInvalid();
+		}
+	}
+	// Throws for a string out of bounds
+	std::string_view GetString(const SnapshotString &str) const;
+	const SnapshotTerm* FindTerm(std::string_view word) const;
+	bool IsStopWord(std::string_view word) const;
+	Query ParseQuery(std::string_view text) const;
+	bool HasPosting(const SnapshotTerm &term, int document_index) const;
+};
+
+template<typename DocumentPredicate>
+std::vector<Document> IndexSnapshot::FindTopDocuments(
+		std::string_view raw_query, DocumentPredicate document_predicate,
+		size_t max_result_count) const {
+	const Query query = ParseQuery(raw_query);
+	ScoreAccumulator &accumulator = ScoreAccumulator::ForCurrentThread();
+	accumulator.Reset(0, header_->document_count);
+	for (const SnapshotTerm *term : query.minus_terms) {
+		const SnapshotPosting *begin = postings_ + term->first_posting;
+		for (const SnapshotPosting *posting = begin;
+				posting != begin + term->posting_count; ++posting) {
+			CheckDocumentIndex(posting->document_index);
+			accumulator.Exclude(posting->document_index);
+		}
+	}
+	for (const SnapshotTerm *term : query.plus_terms) {
+		const SnapshotPosting *begin = postings_ + term->first_posting;
+		for (const SnapshotPosting *posting = begin;
+				posting != begin + term->posting_count; ++posting) {
+			CheckDocumentIndex(posting->document_index);
+			if (accumulator.IsExcluded(posting->document_index)) {
+				continue;
+			}
+			const SnapshotDocument &document = documents_[posting->document_index];
+			if (document_predicate(document.id,
+					static_cast<DocumentStatus>(document.status),
+					document.rating)) {
+				accumulator.Add(posting->document_index,
+						posting->term_freq * term->inverse_document_freq);
+			}
+		}
+	}
+	TopDocuments top_documents(max_result_count);
+	accumulator.ForEachMatched([&](int document_index, double relevance) {
+		const SnapshotDocument &document = documents_[document_index];
+		top_documents.Add( { document.id, relevance, document.rating });
+	});
+	accumulator.Clear();
+	return top_documents.Extract();
+}
@@ -0,0 +1,82 @@
+#include "near_duplicates.h"
+#include <limits>
+
+namespace {
+int FindRoot(std::vector<int> &parents, int index) {
+	while (parents[index] != index) {
+		parents[index] = parents[parents[index]];
+		index = parents[index];
+	}
+	return index;
+}
+}
+
+std::vector<std::vector<int>> FindNearDuplicates(
+		const SearchServer &search_server,
+		const NearDuplicateOptions &options) {
+	return FindNearDuplicates(std::execution::seq, search_server, options);
+}
+
+std::vector<int> RemoveNearDuplicates(SearchServer &search_server,
+		const NearDuplicateOptions &options) {
+	return RemoveNearDuplicates(std::execution::seq, search_server, options);
+}
+
+std::vector<uint64_t> ComputeMinHashSignature(
+		const std::vector<TermId> &term_ids, size_t signature_size) {
+	std::vector<uint64_t> signature(signature_size,
+			std::numeric_limits<uint64_t>::max());
+	for (TermId term_id : term_ids) {
+		// The i-th hash function is the mix of the term hash with the seed i
+		const uint64_t term_hash = MixBits(term_id);
+		for (size_t i = 0; i < signature_size; ++i) {
+			signature[i] = std::min(signature[i], MixBits(term_hash ^ i));
+		}
+	}
+	return signature;
+}
+
+double ComputeJaccardSimilarity(const std::vector<TermId> &lhs,
+		const std::vector<TermId> &rhs) {
+	if (lhs.empty() && rhs.empty()) {
+		return 1.0;
+	}
+	size_t common_count = 0;
+	for (auto lhs_it = lhs.begin(), rhs_it = rhs.begin();
+			lhs_it != lhs.end() && rhs_it != rhs.end();) {
+		if (*lhs_it < *rhs_it) {
+			++lhs_it;
+		} else if (*rhs_it < *lhs_it) {
+			++rhs_it;
+		} else {
+			++common_count;
+			++lhs_it;
+			++rhs_it;
+		}
+	}
+	return common_count * 1.0 / (lhs.size() + rhs.size() - common_count);
+}
+
+std::vector<std::vector<int>> GroupConnectedPairs(size_t count,
+		const std::vector<std::pair<int, int>> &pairs) {
+	std::vector<int> parents(count);
+	std::iota(parents.begin(), parents.end(), 0);
+	for (const auto& [lhs, rhs] : pairs) {
+		const int lhs_root = FindRoot(parents, lhs);
+		const int rhs_root = FindRoot(parents, rhs);
+		// The smaller index becomes the root, so every group is keyed by its
+		// first member
+		parents[std::max(lhs_root, rhs_root)] = std::min(lhs_root, rhs_root);
+	}
+	std::vector<std::vector<int>> members(count);
+	for (size_t i = 0; i < count; ++i) {
+		members[FindRoot(parents, i)].push_back(i);
+	}
+	std::vector<std::vector<int>> groups;
+	for (auto &group : members) {
+		if (group.size() > 1) {
+			groups.push_back(std::move(group));
+		}
+	}
+	return groups;
+}
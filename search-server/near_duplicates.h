@@ -0,0 +1,177 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <numeric>
+#include <utility>
+#include <vector>
+#include "search_server.h"
+#include "remove_duplicates.h"
+
+struct NearDuplicateOptions {
+	// Smallest Jaccard similarity of the word sets of two near-duplicates
+	double jaccard_threshold = 0.8;
+	// MinHash signatures have band_count * rows_per_band values. Two
+	// documents become candidates when all rows of some band are equal, which
+	// happens mostly for similarities above (1 / band_count) ^ (1 /
+	// rows_per_band), about 0.55 for the defaults
+	size_t band_count = 20;
+	size_t rows_per_band = 5;
+	// Every member of an LSH bucket is paired with the next
+	// max_bucket_neighbours members in the order of ids, so buckets of up to
+	// max_bucket_neighbours + 1 documents are paired completely. Larger
+	// buckets, which mostly gather documents of a few very common words,
+	// give a linear number of candidates, and similar members far apart in
+	// such a bucket are found only through another band
+	size_t max_bucket_neighbours = 64;
+};
+
+// Groups documents whose word sets are similar. Candidates are found with
+// MinHash signatures and LSH banding: documents sharing an LSH bucket are
+// paired with each other. Documents without words, such as the ones of stop
+// words only, are similar only to each other and are grouped directly. Then
+// the exact Jaccard similarity of the candidates is checked. Groups are the
+// connected components of the checked pairs, so two members of a group may
+// be less similar than the threshold. Ids in a group are ascending, groups
+// are ordered by their first id.
+template<typename ExecutionPolicy>
+std::vector<std::vector<int>> FindNearDuplicates(const ExecutionPolicy &policy,
+		const SearchServer &search_server,
+		const NearDuplicateOptions &options = { });
+
+std::vector<std::vector<int>> FindNearDuplicates(
+		const SearchServer &search_server,
+		const NearDuplicateOptions &options = { });
+
+// Keeps the member of every group with the highest rating, the one with the
+// smallest id among equally rated. Returns the removed ids in ascending order
+template<typename ExecutionPolicy>
+std::vector<int> RemoveNearDuplicates(const ExecutionPolicy &policy,
+		SearchServer &search_server,
+		const NearDuplicateOptions &options = { });
+
+std::vector<int> RemoveNearDuplicates(SearchServer &search_server,
+		const NearDuplicateOptions &options = { });
+
+std::vector<uint64_t> ComputeMinHashSignature(
+		const std::vector<TermId> &term_ids, size_t signature_size);
+
+// Both term lists must be sorted
+double ComputeJaccardSimilarity(const std::vector<TermId> &lhs,
+		const std::vector<TermId> &rhs);
+
+// Groups connected components of the pairs of indexes in [0, count)
+std::vector<std::vector<int>> GroupConnectedPairs(size_t count,
+		const std::vector<std::pair<int, int>> &pairs);
+
+template<typename ExecutionPolicy>
+std::vector<std::vector<int>> FindNearDuplicates(const ExecutionPolicy &policy,
+		const SearchServer &search_server,
+		const NearDuplicateOptions &options) {
+	const std::vector<int> document_ids(search_server.begin(),
+			search_server.end());
+	const size_t document_count = document_ids.size();
+	const size_t signature_size = options.band_count * options.rows_per_band;
+	std::vector<std::vector<TermId>> term_ids(document_count);
+	std::vector<std::vector<uint64_t>> signatures(document_count);
+	std::vector<int> indexes(document_count);
+	std::iota(indexes.begin(), indexes.end(), 0);
+	std::for_each(policy, indexes.begin(), indexes.end(), [&](int i) {
+		term_ids[i] = search_server.GetDocumentTermIds(document_ids[i]);
+		signatures[i] = ComputeMinHashSignature(term_ids[i], signature_size);
+	});
+
+	// Documents without words would share a bucket of every band, so they
+	// are paired with the first of them instead
+	std::vector<std::pair<int, int>> candidates;
+	std::vector<int> banded_indexes;
+	int first_empty = -1;
+	for (int i = 0; i < static_cast<int>(document_count); ++i) {
+		if (!term_ids[i].empty()) {
+			banded_indexes.push_back(i);
+		} else if (first_empty < 0) {
+			first_empty = i;
+		} else {
+			candidates.emplace_back(first_empty, i);
+		}
+	}
+
+	// Documents with equal rows of a band share a bucket of that band
+	const size_t banded_count = banded_indexes.size();
+	std::vector<std::pair<uint64_t, int>> buckets(banded_count);
+	for (size_t band = 0; band < options.band_count; ++band) {
+		const size_t first_row = band * options.rows_per_band;
+		for (size_t k = 0; k < banded_count; ++k) {
+			const int i = banded_indexes[k];
+			uint64_t bucket = band;
+			for (size_t row = first_row; row < first_row + options.rows_per_band;
+					++row) {
+				bucket = bucket * 0x100000001b3 ^ signatures[i][row];
+			}
+			buckets[k] = { bucket, i };
+		}
+		std::sort(policy, buckets.begin(), buckets.end());
+		for (size_t begin = 0; begin < banded_count;) {
+			size_t end = begin + 1;
+			while (end < banded_count
+					&& buckets[end].first == buckets[begin].first) {
+				++end;
+			}
+			for (size_t i = begin; i < end; ++i) {
+				const size_t last = std::min(end,
+						i + 1 + options.max_bucket_neighbours);
+				for (size_t j = i + 1; j < last; ++j) {
+					candidates.emplace_back(buckets[i].second,
+							buckets[j].second);
+				}
+			}
+			begin = end;
+		}
+	}
+	std::sort(policy, candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()),
+			candidates.end());
+
+	std::vector<char> is_similar(candidates.size());
+	std::transform(policy, candidates.begin(), candidates.end(),
+			is_similar.begin(), [&](const std::pair<int, int> &candidate) {
+				return ComputeJaccardSimilarity(term_ids[candidate.first],
+						term_ids[candidate.second])
+						>= options.jaccard_threshold;
+			});
+	std::vector<std::pair<int, int>> similar_pairs;
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		if (is_similar[i]) {
+			similar_pairs.push_back(candidates[i]);
+		}
+	}
+	auto groups = GroupConnectedPairs(document_count, similar_pairs);
+	for (auto &group : groups) {
+		for (int &member : group) {
+			member = document_ids[member];
+		}
+	}
+	return groups;
+}
+
+template<typename ExecutionPolicy>
+std::vector<int> RemoveNearDuplicates(const ExecutionPolicy &policy,
+		SearchServer &search_server, const NearDuplicateOptions &options) {
+	std::vector<int> removed_ids;
+	for (const auto &group : FindNearDuplicates(policy, search_server,
+			options)) {
+		const int kept_id = *std::max_element(group.begin(), group.end(),
+				[&search_server](int lhs, int rhs) {
+					return std::pair(search_server.GetDocumentRating(lhs), -lhs)
+							< std::pair(search_server.GetDocumentRating(rhs),
+									-rhs);
+				});
+		std::copy_if(group.begin(), group.end(),
+				std::back_inserter(removed_ids), [kept_id](int document_id) {
+					return document_id != kept_id;
+				});
+	}
+	std::sort(removed_ids.begin(), removed_ids.end());
+	search_server.RemoveDocuments(policy, removed_ids);
+	return removed_ids;
+}
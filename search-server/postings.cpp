@@ -0,0 +1,343 @@
+#include "postings.h"
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+// Deltas are split into four lanes, value i going to lane i % 4. Every lane is
+// a bit stream of BLOCK_SIZE / 4 values, and word w of lane l is stored at
+// words[4 * w + l], so one 16-byte load fetches the next word of every lane
+const size_t LANE_COUNT = 4;
+
+void PackDeltas(const uint32_t *deltas, int bit_width, uint32_t *words) {
+	for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+		int bit = 0;
+		for (size_t i = lane; i < Postings::BLOCK_SIZE; i += LANE_COUNT) {
+			const int word = bit / 32;
+			const int shift = bit % 32;
+			words[LANE_COUNT * word + lane] |= deltas[i] << shift;
+			if (shift + bit_width > 32) {
+				words[LANE_COUNT * (word + 1) + lane] |= deltas[i]
+						>> (32 - shift);
+			}
+			bit += bit_width;
+		}
+	}
+}
+
+#ifdef __SSE2__
+void UnpackDeltas(const uint32_t *words, int bit_width, int *deltas) {
+	const __m128i mask = _mm_set1_epi32(
+			static_cast<int>(bit_width == 32 ?
+					~uint32_t { 0 } : (uint32_t { 1 } << bit_width) - 1));
+	const __m128i *in = reinterpret_cast<const __m128i*>(words);
+	__m128i current = _mm_loadu_si128(in);
+	int word = 0;
+	int shift = 0;
+	for (size_t i = 0; i < Postings::BLOCK_SIZE; i += LANE_COUNT) {
+		__m128i value = _mm_srl_epi32(current, _mm_cvtsi32_si128(shift));
+		shift += bit_width;
+		if (shift >= 32) {
+			shift -= 32;
+			if (++word < bit_width) {
+				current = _mm_loadu_si128(in + word);
+				// The high bits of the value start the next word
+				if (shift > 0) {
+					value = _mm_or_si128(value, _mm_sll_epi32(current,
+							_mm_cvtsi32_si128(bit_width - shift)));
+				}
+			}
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(deltas + i),
+				_mm_and_si128(value, mask));
+	}
+}
+
+// Turns deltas into document indexes, four prefix sums at a time
+void RestoreDocumentIndexes(int first_document_index, int *values) {
+	__m128i carry = _mm_set1_epi32(first_document_index);
+	for (size_t i = 0; i < Postings::BLOCK_SIZE; i += LANE_COUNT) {
+		__m128i *chunk = reinterpret_cast<__m128i*>(values + i);
+		__m128i sums = _mm_loadu_si128(chunk);
+		sums = _mm_add_epi32(sums, _mm_slli_si128(sums, 4));
+		sums = _mm_add_epi32(sums, _mm_slli_si128(sums, 8));
+		sums = _mm_add_epi32(sums, carry);
+		_mm_storeu_si128(chunk, sums);
+		carry = _mm_shuffle_epi32(sums, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+}
+#else
+void UnpackDeltas(const uint32_t *words, int bit_width, int *deltas) {
+	const uint64_t mask = (uint64_t { 1 } << bit_width) - 1;
+	for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+		int bit = 0;
+		for (size_t i = lane; i < Postings::BLOCK_SIZE; i += LANE_COUNT) {
+			const int word = bit / 32;
+			const int shift = bit % 32;
+			uint64_t value = words[LANE_COUNT * word + lane] >> shift;
+			if (shift + bit_width > 32) {
+				value |= uint64_t { words[LANE_COUNT * (word + 1) + lane] }
+						<< (32 - shift);
+			}
+			deltas[i] = static_cast<int>(value & mask);
+			bit += bit_width;
+		}
+	}
+}
+
+void RestoreDocumentIndexes(int first_document_index, int *values) {
+	int document_index = first_document_index;
+	for (size_t i = 0; i < Postings::BLOCK_SIZE; ++i) {
+		document_index += values[i];
+		values[i] = document_index;
+	}
+}
+#endif
+
+template<typename Count>
+void UnpackTermCounts(const uint8_t *bytes, int *term_counts) {
+	for (size_t i = 0; i < Postings::BLOCK_SIZE; ++i) {
+		Count term_count;
+		std::memcpy(&term_count, bytes + i * sizeof(Count), sizeof(Count));
+		term_counts[i] = term_count;
+	}
+}
+}
+
+Postings::Cursor::Cursor(const Postings &postings) :
+		postings_(&postings) {
+	if (InBlock()) {
+		EnterBlock(0);
+	}
+}
+
+void Postings::Cursor::NextBlock() {
+	if (block_ + 1 < postings_->blocks_.size()) {
+		EnterBlock(block_ + 1);
+	} else {
+		block_ = postings_->blocks_.size();
+		position_ = 0;
+	}
+}
+
+void Postings::Cursor::Seek(int document_index) {
+	if (IsDone() || GetDocumentIndex() >= document_index) {
+		return;
+	}
+	if (InBlock()) {
+		const auto &blocks = postings_->blocks_;
+		if (document_index > blocks[block_].last_document_index) {
+			const auto block = std::lower_bound(blocks.begin() + block_ + 1,
+					blocks.end(), document_index,
+					[](const Block &block, int index) {
+						return block.last_document_index < index;
+					});
+			if (block == blocks.end()) {
+				block_ = blocks.size();
+				position_ = 0;
+			} else {
+				EnterBlock(block - blocks.begin());
+			}
+		}
+		if (InBlock()) {
+			position_ = std::lower_bound(document_indexes_ + position_,
+					document_indexes_ + BLOCK_SIZE, document_index)
+					- document_indexes_;
+			return;
+		}
+	}
+	const auto &tail = postings_->tail_;
+	position_ = std::lower_bound(tail.begin() + position_, tail.end(),
+			document_index, [](const Posting &posting, int index) {
+				return posting.document_index < index;
+			}) - tail.begin();
+}
+
+void Postings::Cursor::EnterBlock(size_t block) {
+	block_ = block;
+	position_ = 0;
+	postings_->DecodeBlock(postings_->blocks_[block], document_indexes_,
+			term_counts_);
+}
+
+void Postings::Append(int document_index, int term_count) {
+	tail_.push_back( { document_index, term_count });
+	if (compressed_ && tail_.size() == BLOCK_SIZE) {
+		EncodeBlock(tail_.data());
+		tail_.clear();
+	}
+}
+
+bool Postings::Contains(int document_index) const {
+	const auto block = FindBlock(document_index);
+	if (block == blocks_.end()) {
+		const auto it = FindInTail(document_index);
+		return it != tail_.end() && it->document_index == document_index;
+	}
+	if (block->first_document_index > document_index) {
+		return false;
+	}
+	int document_indexes[BLOCK_SIZE];
+	int term_counts[BLOCK_SIZE];
+	DecodeBlock(*block, document_indexes, term_counts);
+	return std::binary_search(document_indexes, document_indexes + BLOCK_SIZE,
+			document_index);
+}
+
+void Postings::Remove(const int *begin, const int *end) {
+	if (begin == end) {
+		return;
+	}
+	// Postings before the first removed one stay where they are, the rest
+	// are decoded, merged with [begin, end) and appended back
+	const auto first_block = FindBlock(*begin);
+	std::vector<Posting> postings;
+	if (first_block == blocks_.end()) {
+		postings.assign(FindInTail(*begin), tail_.cend());
+		tail_.erase(FindInTail(*begin), tail_.cend());
+	} else {
+		postings.reserve(
+				(blocks_.end() - first_block) * BLOCK_SIZE + tail_.size());
+		ForEachInRange(first_block->first_document_index, INT_MAX,
+				[&postings](int document_index, int term_count) {
+					postings.push_back( { document_index, term_count });
+				});
+		TruncateBlocks(first_block);
+		tail_.clear();
+	}
+	for (const Posting &posting : postings) {
+		while (begin != end && *begin < posting.document_index) {
+			++begin;
+		}
+		if (begin == end || *begin != posting.document_index) {
+			Append(posting.document_index, posting.term_count);
+		}
+	}
+}
+
+void Postings::Compress() {
+	if (compressed_) {
+		return;
+	}
+	compressed_ = true;
+	std::vector<Posting> postings;
+	postings.swap(tail_);
+	size_t i = 0;
+	for (; i + BLOCK_SIZE <= postings.size(); i += BLOCK_SIZE) {
+		EncodeBlock(postings.data() + i);
+	}
+	tail_.assign(postings.begin() + i, postings.end());
+	blocks_.shrink_to_fit();
+	delta_words_.shrink_to_fit();
+	term_counts_.shrink_to_fit();
+}
+
+void Postings::Decompress() {
+	if (!compressed_) {
+		return;
+	}
+	std::vector<Posting> postings;
+	postings.reserve(size());
+	ForEach([&postings](int document_index, int term_count) {
+		postings.push_back( { document_index, term_count });
+	});
+	TruncateBlocks(blocks_.begin());
+	blocks_.shrink_to_fit();
+	delta_words_.shrink_to_fit();
+	term_counts_.shrink_to_fit();
+	tail_.swap(postings);
+	compressed_ = false;
+}
+
+size_t Postings::GetMemoryUsage() const {
+	return blocks_.capacity() * sizeof(Block)
+			+ delta_words_.capacity() * sizeof(uint32_t)
+			+ term_counts_.capacity() + tail_.capacity() * sizeof(Posting);
+}
+
+void Postings::EncodeBlock(const Posting *postings) {
+	uint32_t deltas[BLOCK_SIZE];
+	uint32_t delta_bits = 0;
+	uint32_t max_term_count = 0;
+	for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+		deltas[i] = i == 0 ?
+				0 : postings[i].document_index - postings[i - 1].document_index;
+		delta_bits |= deltas[i];
+		max_term_count = std::max<uint32_t>(max_term_count,
+				postings[i].term_count);
+	}
+	Block block;
+	block.first_document_index = postings[0].document_index;
+	block.last_document_index = postings[BLOCK_SIZE - 1].document_index;
+	block.delta_offset = delta_words_.size();
+	block.term_count_offset = term_counts_.size();
+	block.bit_width = delta_bits == 0 ? 0 : 32 - __builtin_clz(delta_bits);
+	block.term_count_bytes =
+			max_term_count <= UINT8_MAX ? 1 :
+			max_term_count <= UINT16_MAX ? 2 : 4;
+	delta_words_.resize(
+			delta_words_.size() + BLOCK_SIZE / 32 * block.bit_width);
+	PackDeltas(deltas, block.bit_width,
+			delta_words_.data() + block.delta_offset);
+	term_counts_.resize(
+			term_counts_.size() + BLOCK_SIZE * block.term_count_bytes);
+	uint8_t *bytes = term_counts_.data() + block.term_count_offset;
+	for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+		const uint32_t term_count = postings[i].term_count;
+		if (block.term_count_bytes == 1) {
+			bytes[i] = term_count;
+		} else if (block.term_count_bytes == 2) {
+			const uint16_t value = term_count;
+			std::memcpy(bytes + 2 * i, &value, sizeof(value));
+		} else {
+			std::memcpy(bytes + 4 * i, &term_count, sizeof(term_count));
+		}
+	}
+	blocks_.push_back(block);
+}
+
+void Postings::DecodeBlock(const Block &block, int *document_indexes,
+		int *term_counts) const {
+	if (block.bit_width == 0) {
+		std::fill(document_indexes, document_indexes + BLOCK_SIZE, 0);
+	} else {
+		UnpackDeltas(delta_words_.data() + block.delta_offset, block.bit_width,
+				document_indexes);
+	}
+	RestoreDocumentIndexes(block.first_document_index, document_indexes);
+	const uint8_t *bytes = term_counts_.data() + block.term_count_offset;
+	if (block.term_count_bytes == 1) {
+		UnpackTermCounts<uint8_t>(bytes, term_counts);
+	} else if (block.term_count_bytes == 2) {
+		UnpackTermCounts<uint16_t>(bytes, term_counts);
+	} else {
+		UnpackTermCounts<uint32_t>(bytes, term_counts);
+	}
+}
+
+std::vector<Postings::Block>::const_iterator Postings::FindBlock(
+		int document_index) const {
+	return std::lower_bound(blocks_.begin(), blocks_.end(), document_index,
+			[](const Block &block, int index) {
+				return block.last_document_index < index;
+			});
+}
+
+std::vector<Posting>::const_iterator Postings::FindInTail(
+		int document_index) const {
+	return std::lower_bound(tail_.begin(), tail_.end(), document_index,
+			[](const Posting &posting, int index) {
+				return posting.document_index < index;
+			});
+}
+
+void Postings::TruncateBlocks(std::vector<Block>::const_iterator first) {
+	if (first == blocks_.end()) {
+		return;
+	}
+	delta_words_.resize(first->delta_offset);
+	term_counts_.resize(first->term_count_offset);
+	blocks_.erase(first, blocks_.cend());
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A document index and the number of occurrences of the term in the document
+struct Posting {
+	int document_index;
+	int term_count;
+};
+
+// Postings of one term sorted by document index. The plain layout stores
+// them as they are. The compressed layout packs every full block of
+// BLOCK_SIZE postings: document indexes become deltas of the smallest bit
+// width fitting the block, interleaved so that SSE2 unpacks four of them at
+// once, and term counts take the 1, 2 or 4 bytes needed by the largest one.
+// Postings after the last full block stay plain, so appending costs the same
+// in both layouts.
+class Postings {
+public:
+	static constexpr size_t BLOCK_SIZE = 128;
+
+	// Walks the postings in ascending order of document index, decoding one
+	// block at a time. Invalidated by any change of the postings
+	class Cursor {
+	public:
+		explicit Cursor(const Postings &postings);
+
+		bool IsDone() const {
+			return !InBlock() && position_ == postings_->tail_.size();
+		}
+
+		// Valid only when !IsDone()
+		int GetDocumentIndex() const {
+			return InBlock() ?
+					document_indexes_[position_] :
+					postings_->tail_[position_].document_index;
+		}
+
+		int GetTermCount() const {
+			return InBlock() ?
+					term_counts_[position_] :
+					postings_->tail_[position_].term_count;
+		}
+
+		void Next() {
+			++position_;
+			if (InBlock() && position_ == BLOCK_SIZE) {
+				NextBlock();
+			}
+		}
+
+		// Calls func(document_index, term_count) for the postings before the
+		// given document index and stops at the first one that is not
+		template<typename Func>
+		void ForEachBefore(int document_index, Func func);
+
+		// Moves to the first posting with document index not less than the
+		// given one. It is usually a few postings ahead, so those are checked
+		// before searching, which skips whole blocks
+		void Advance(int document_index) {
+			const size_t size = InBlock() ? BLOCK_SIZE : postings_->tail_.size();
+			for (size_t step = 0; step < LINEAR_ADVANCE_STEPS
+					&& position_ + 1 < size
+					&& GetDocumentIndex() < document_index; ++step) {
+				++position_;
+			}
+			if (position_ < size && GetDocumentIndex() >= document_index) {
+				return;
+			}
+			Seek(document_index);
+		}
+
+	private:
+		static constexpr size_t LINEAR_ADVANCE_STEPS = 8;
+
+		const Postings *postings_;
+		size_t block_ = 0;
+		// Position in the decoded block or in the tail
+		size_t position_ = 0;
+		int document_indexes_[BLOCK_SIZE];
+		int term_counts_[BLOCK_SIZE];
+
+		bool InBlock() const {
+			return block_ < postings_->blocks_.size();
+		}
+
+		void EnterBlock(size_t block);
+		void NextBlock();
+		// Advance past the postings checked linearly
+		void Seek(int document_index);
+	};
+
+	size_t size() const {
+		return blocks_.size() * BLOCK_SIZE + tail_.size();
+	}
+
+	bool empty() const {
+		return blocks_.empty() && tail_.empty();
+	}
+
+	// document_index must be greater than the indexes already stored
+	void Append(int document_index, int term_count);
+
+	bool Contains(int document_index) const;
+
+	// Calls func(document_index, term_count) for the postings with document
+	// indexes in [begin, end) in ascending order
+	template<typename Func>
+	void ForEachInRange(int begin, int end, Func func) const;
+
+	template<typename Func>
+	void ForEach(Func func) const {
+		ForEachInRange(0, INT_MAX, func);
+	}
+
+	// Erases the postings of the documents in [begin, end), which is sorted
+	void Remove(const int *begin, const int *end);
+
+	void Compress();
+	void Decompress();
+
+	bool IsCompressed() const {
+		return compressed_;
+	}
+
+	size_t GetMemoryUsage() const;
+
+private:
+	struct Block {
+		int first_document_index;
+		int last_document_index;
+		// Positions of the block in delta_words_ and term_counts_
+		uint32_t delta_offset;
+		uint32_t term_count_offset;
+		uint8_t bit_width;
+		uint8_t term_count_bytes;
+	};
+
+	bool compressed_ = false;
+	std::vector<Block> blocks_;
+	std::vector<uint32_t> delta_words_;
+	std::vector<uint8_t> term_counts_;
+	// Postings after the last block, which are all of them in the plain layout
+	std::vector<Posting> tail_;
+
+	// Packs BLOCK_SIZE postings into a new block
+	void EncodeBlock(const Posting *postings);
+	void DecodeBlock(const Block &block, int *document_indexes,
+			int *term_counts) const;
+	// The first block ending at document_index or after it
+	std::vector<Block>::const_iterator FindBlock(int document_index) const;
+	std::vector<Posting>::const_iterator FindInTail(int document_index) const;
+	// Drops the blocks starting from the given one
+	void TruncateBlocks(std::vector<Block>::const_iterator first);
+};
+
+template<typename Func>
+void Postings::ForEachInRange(int begin, int end, Func func) const {
+	int document_indexes[BLOCK_SIZE];
+	int term_counts[BLOCK_SIZE];
+	for (auto block = FindBlock(begin);
+			block != blocks_.end() && block->first_document_index < end;
+			++block) {
+		DecodeBlock(*block, document_indexes, term_counts);
+		for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+			if (document_indexes[i] >= end) {
+				return;
+			}
+			if (document_indexes[i] >= begin) {
+				func(document_indexes[i], term_counts[i]);
+			}
+		}
+	}
+	for (auto it = FindInTail(begin);
+			it != tail_.end() && it->document_index < end; ++it) {
+		func(it->document_index, it->term_count);
+	}
+}
+
+template<typename Func>
+void Postings::Cursor::ForEachBefore(int document_index, Func func) {
+	while (InBlock()) {
+		for (; position_ < BLOCK_SIZE; ++position_) {
+			if (document_indexes_[position_] >= document_index) {
+				return;
+			}
+			func(document_indexes_[position_], term_counts_[position_]);
+		}
+		NextBlock();
+	}
+	const std::vector<Posting> &tail = postings_->tail_;
+	for (; position_ < tail.size() && tail[position_].document_index
+			< document_index; ++position_) {
+		func(tail[position_].document_index, tail[position_].term_count);
+	}
+}
@@ -0,0 +1,53 @@
+#include "query_cache.h"
+
+QueryCache::QueryCache(size_t capacity) :
+		capacity_(capacity) {
+}
+
+std::optional<std::vector<Document>> QueryCache::Find(const std::string &key,
+		uint64_t generation) {
+	std::lock_guard guard(mutex_);
+	const auto it = index_.find(key);
+	if (it == index_.end()) {
+		++stats_.misses;
+		return std::nullopt;
+	}
+	const auto entry_it = it->second;
+	if (entry_it->generation != generation) {
+		index_.erase(it);
+		entries_.erase(entry_it);
+		++stats_.invalidations;
+		++stats_.misses;
+		return std::nullopt;
+	}
+	entries_.splice(entries_.begin(), entries_, entry_it);
+	++stats_.hits;
+	return entry_it->documents;
+}
+
+void QueryCache::Insert(const std::string &key, uint64_t generation,
+		const std::vector<Document> &documents) {
+	if (capacity_ == 0) {
+		return;
+	}
+	std::lock_guard guard(mutex_);
+	const auto it = index_.find(key);
+	if (it != index_.end()) {
+		it->second->generation = generation;
+		it->second->documents = documents;
+		entries_.splice(entries_.begin(), entries_, it->second);
+		return;
+	}
+	if (entries_.size() == capacity_) {
+		index_.erase(entries_.back().key);
+		entries_.pop_back();
+		++stats_.evictions;
+	}
+	entries_.push_front( { key, generation, documents });
+	index_.emplace(entries_.front().key, entries_.begin());
+}
+
+QueryCacheStats QueryCache::GetStats() const {
+	std::lock_guard guard(mutex_);
+	return stats_;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "document.h"
+
+struct QueryCacheStats {
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t evictions = 0;
+	// Entries dropped because the index changed after they were stored
+	size_t invalidations = 0;
+};
+
+// Thread-safe LRU cache of search results. Every entry remembers the index
+// generation it was computed for and is treated as a miss once the generation
+// moves on.
+class QueryCache {
+public:
+	explicit QueryCache(size_t capacity);
+
+	std::optional<std::vector<Document>> Find(const std::string &key,
+			uint64_t generation);
+
+	void Insert(const std::string &key, uint64_t generation,
+			const std::vector<Document> &documents);
+
+	QueryCacheStats GetStats() const;
+
+private:
+	struct Entry {
+		std::string key;
+		uint64_t generation;
+		std::vector<Document> documents;
+	};
+
+	const size_t capacity_;
+	mutable std::mutex mutex_;
+	// Most recently used entries come first
+	std::list<Entry> entries_;
+	std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+	QueryCacheStats stats_;
+};
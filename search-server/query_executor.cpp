@@ -0,0 +1,160 @@
+#include "query_executor.h"
+#include <algorithm>
+
+QueryExecutor::QueryExecutor(size_t thread_count) {
+	thread_count = std::max<size_t>(1, thread_count);
+	for (size_t i = 0; i < thread_count; ++i) {
+		queues_.push_back(std::make_unique<WorkerQueue>());
+		scratches_.push_back(std::make_unique<SearchServer::QueryScratch>());
+	}
+	threads_.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; ++i) {
+		threads_.emplace_back(&QueryExecutor::Work, this, i);
+	}
+}
+
+QueryExecutor::~QueryExecutor() {
+	{
+		std::lock_guard guard(mutex_);
+		stopping_ = true;
+	}
+	wakeup_.notify_all();
+	for (std::thread &thread : threads_) {
+		thread.join();
+	}
+}
+
+std::vector<std::vector<Document>> QueryExecutor::ProcessQueries(
+		const SearchServer &search_server,
+		const std::vector<std::string> &queries) {
+	std::vector<std::vector<Document>> results(queries.size());
+	RunBatch(queries.size(), [&](size_t i, SearchServer::QueryScratch &scratch) {
+		results[i] = search_server.FindTopDocuments(queries[i],
+				DocumentStatus::ACTUAL, scratch);
+	});
+	return results;
+}
+
+JoinedQueryResults QueryExecutor::ProcessQueriesJoined(
+		const SearchServer &search_server,
+		const std::vector<std::string> &queries) {
+	// Every query gets a slot of MAX_RESULT_DOCUMENT_COUNT documents, and
+	// the slots are compacted once all queries are done
+	JoinedQueryResults results;
+	results.documents.resize(queries.size() * MAX_RESULT_DOCUMENT_COUNT);
+	std::vector<size_t> counts(queries.size());
+	RunBatch(queries.size(), [&](size_t i, SearchServer::QueryScratch &scratch) {
+		const auto &documents = search_server.FindTopDocuments(queries[i],
+				DocumentStatus::ACTUAL, scratch);
+		std::copy(documents.begin(), documents.end(),
+				results.documents.begin() + i * MAX_RESULT_DOCUMENT_COUNT);
+		counts[i] = documents.size();
+	});
+	results.offsets.reserve(queries.size() + 1);
+	results.offsets.push_back(0);
+	for (size_t i = 0; i < queries.size(); ++i) {
+		const auto slot = results.documents.begin()
+				+ i * MAX_RESULT_DOCUMENT_COUNT;
+		std::copy(slot, slot + counts[i],
+				results.documents.begin() + results.offsets.back());
+		results.offsets.push_back(results.offsets.back() + counts[i]);
+	}
+	results.documents.resize(results.offsets.back());
+	return results;
+}
+
+size_t QueryExecutor::GetThreadCount() const {
+	return threads_.size();
+}
+
+void QueryExecutor::RunBatch(size_t task_count, const Task &task) {
+	if (task_count == 0) {
+		return;
+	}
+	std::lock_guard batch_guard(batch_mutex_);
+	const size_t worker_count = queues_.size();
+	for (size_t worker = 0; worker < worker_count; ++worker) {
+		std::lock_guard guard(queues_[worker]->mutex);
+		for (size_t i = task_count * worker / worker_count;
+				i < task_count * (worker + 1) / worker_count; ++i) {
+			queues_[worker]->tasks.push_back(i);
+		}
+	}
+	std::unique_lock lock(mutex_);
+	task_ = &task;
+	remaining_tasks_ = task_count;
+	exception_ = nullptr;
+	++batch_;
+	wakeup_.notify_all();
+	// A worker may still hold the task after the last one is done, so the
+	// batch ends only when every worker has let it go
+	done_.wait(lock, [this] {
+		return remaining_tasks_ == 0 && active_workers_ == 0;
+	});
+	task_ = nullptr;
+	if (exception_) {
+		std::rethrow_exception(exception_);
+	}
+}
+
+void QueryExecutor::Work(size_t worker) {
+	uint64_t seen_batch = 0;
+	std::unique_lock lock(mutex_);
+	while (true) {
+		wakeup_.wait(lock, [&] {
+			return stopping_ || batch_ != seen_batch;
+		});
+		if (stopping_) {
+			return;
+		}
+		seen_batch = batch_;
+		const Task *task = task_;
+		if (task == nullptr) {
+			continue;
+		}
+		++active_workers_;
+		lock.unlock();
+		size_t done_tasks = 0;
+		std::exception_ptr exception;
+		size_t i;
+		while (PopTask(worker, i)) {
+			try {
+				(*task)(i, *scratches_[worker]);
+			} catch (...) {
+				exception = std::current_exception();
+			}
+			++done_tasks;
+		}
+		lock.lock();
+		if (exception && !exception_) {
+			exception_ = exception;
+		}
+		remaining_tasks_ -= done_tasks;
+		--active_workers_;
+		if (remaining_tasks_ == 0 && active_workers_ == 0) {
+			done_.notify_all();
+		}
+	}
+}
+
+bool QueryExecutor::PopTask(size_t worker, size_t &task) {
+	{
+		WorkerQueue &own = *queues_[worker];
+		std::lock_guard guard(own.mutex);
+		if (!own.tasks.empty()) {
+			task = own.tasks.front();
+			own.tasks.pop_front();
+			return true;
+		}
+	}
+	for (size_t i = 1; i < queues_.size(); ++i) {
+		WorkerQueue &victim = *queues_[(worker + i) % queues_.size()];
+		std::lock_guard guard(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.back();
+			victim.tasks.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
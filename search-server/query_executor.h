@@ -0,0 +1,77 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "search_server.h"
+
+// Results of a batch of queries stored one after another. Documents found
+// for query i are documents[offsets[i]] up to documents[offsets[i + 1]]
+struct JoinedQueryResults {
+	std::vector<Document> documents;
+	std::vector<size_t> offsets;
+};
+
+// Fixed pool of threads running batches of queries. Every worker starts with
+// a contiguous block of the batch and steals single queries from the back of
+// the other blocks once its own is done, so a few expensive queries do not
+// hold up the rest of the batch. The threads live as long as the executor,
+// so the per-thread scratch buffers SearchServer keeps for parsing and
+// scoring are reused from one batch to the next. Every worker also keeps its
+// own query scratch, so parsed queries, IDFs and the top documents heap are
+// cleared between queries instead of allocated for each one.
+class QueryExecutor {
+public:
+	explicit QueryExecutor(size_t thread_count = std::max(1u,
+			std::thread::hardware_concurrency()));
+	~QueryExecutor();
+
+	QueryExecutor(const QueryExecutor&) = delete;
+	QueryExecutor& operator=(const QueryExecutor&) = delete;
+
+	std::vector<std::vector<Document>> ProcessQueries(
+			const SearchServer &search_server,
+			const std::vector<std::string> &queries);
+
+	JoinedQueryResults ProcessQueriesJoined(const SearchServer &search_server,
+			const std::vector<std::string> &queries);
+
+	size_t GetThreadCount() const;
+
+private:
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+	};
+
+	// Called with the index of the task and the scratch of the worker
+	using Task = std::function<void(size_t, SearchServer::QueryScratch&)>;
+
+	std::vector<std::unique_ptr<WorkerQueue>> queues_;
+	std::vector<std::unique_ptr<SearchServer::QueryScratch>> scratches_;
+	// Serializes batches submitted from different threads
+	std::mutex batch_mutex_;
+	// Guards the state of the current batch below
+	std::mutex mutex_;
+	std::condition_variable wakeup_;
+	std::condition_variable done_;
+	const Task *task_ = nullptr;
+	uint64_t batch_ = 0;
+	size_t remaining_tasks_ = 0;
+	size_t active_workers_ = 0;
+	std::exception_ptr exception_;
+	bool stopping_ = false;
+	std::vector<std::thread> threads_;
+
+	// Calls task(i, scratch) for every i in [0, task_count) and rethrows the
+	// first exception thrown by the task
+	void RunBatch(size_t task_count, const Task &task);
+	void Work(size_t worker);
+	bool PopTask(size_t worker, size_t &task);
+};
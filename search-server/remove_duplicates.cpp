@@ -1,26 +1,32 @@
-#include <map>
-#include <set>
-#include <string>
+#include <tuple>
 #include "search_server.h"
 #include "remove_duplicates.h"
 
-void RemoveDuplicates(SearchServer &search_server) {
-	std::set<std::set<std::string>> dupl;
-	std::set<int> id_to_delete;
-	for (int id : search_server) {
-		std::map<std::string_view, double> found_words = search_server.GetWordFrequencies(id);
-		std::set<std::string> words;
-		for (const auto &word : found_words) {
-			words.insert(std::string(word.first));
-		}
-		if (dupl.count(words)) {
-			id_to_delete.insert(id);
-			cout << "Found duplicate document id " << id << endl;
-		} else {
-			dupl.insert(words);
-		}
-	}
-	for (int id : id_to_delete) {
-		search_server.RemoveDocument(id);
+uint64_t MixBits(uint64_t value) {
+	value += 0x9e3779b97f4a7c15;
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+	return value ^ (value >> 31);
+}
+
+bool DocumentFingerprint::operator==(const DocumentFingerprint &other) const {
+	return low == other.low && high == other.high;
+}
+
+bool DocumentFingerprint::operator<(const DocumentFingerprint &other) const {
+	return std::tie(high, low) < std::tie(other.high, other.low);
+}
+
+DocumentFingerprint ComputeFingerprint(const std::vector<TermId> &term_ids) {
+	// Sums do not depend on the order of the terms
+	DocumentFingerprint fingerprint;
+	for (TermId term_id : term_ids) {
+		fingerprint.low += MixBits(term_id);
+		fingerprint.high += MixBits(MixBits(term_id) ^ 0x5851f42d4c957f2d);
 	}
+	return fingerprint;
+}
+
+std::vector<int> RemoveDuplicates(SearchServer &search_server) {
+	return RemoveDuplicates(std::execution::seq, search_server);
 }
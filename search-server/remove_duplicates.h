@@ -1,4 +1,76 @@
 #pragma once
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <utility>
+#include <vector>
 #include "search_server.h"
 
-void RemoveDuplicates(SearchServer &search_server);
+// Order-independent 128-bit hash of a document's set of terms
+struct DocumentFingerprint {
+	uint64_t low = 0;
+	uint64_t high = 0;
+
+	bool operator==(const DocumentFingerprint &other) const;
+	bool operator<(const DocumentFingerprint &other) const;
+};
+
+// Finalizer of SplitMix64. Spreads consecutive term ids over all bits
+uint64_t MixBits(uint64_t value);
+
+DocumentFingerprint ComputeFingerprint(const std::vector<TermId> &term_ids);
+
+// Removes every document whose set of words equals the one of a document
+// with a smaller id. Documents are fingerprinted in parallel under a parallel
+// policy, equal fingerprints are confirmed by comparing the terms, and all
+// duplicates are removed in one batch under the same policy. Returns the
+// removed ids in ascending order
+template<typename ExecutionPolicy>
+std::vector<int> RemoveDuplicates(const ExecutionPolicy &policy,
+		SearchServer &search_server);
+
+std::vector<int> RemoveDuplicates(SearchServer &search_server);
+
+template<typename ExecutionPolicy>
+std::vector<int> RemoveDuplicates(const ExecutionPolicy &policy,
+		SearchServer &search_server) {
+	struct Entry {
+		DocumentFingerprint fingerprint;
+		int document_id;
+		std::vector<TermId> term_ids;
+	};
+	std::vector<Entry> entries;
+	entries.reserve(search_server.GetDocumentCount());
+	for (int document_id : search_server) {
+		entries.push_back( { { }, document_id, { } });
+	}
+	std::for_each(policy, entries.begin(), entries.end(), [&](Entry &entry) {
+		entry.term_ids = search_server.GetDocumentTermIds(entry.document_id);
+		entry.fingerprint = ComputeFingerprint(entry.term_ids);
+	});
+	std::sort(policy, entries.begin(), entries.end(),
+			[](const Entry &lhs, const Entry &rhs) {
+				return std::pair(lhs.fingerprint, lhs.document_id)
+						< std::pair(rhs.fingerprint, rhs.document_id);
+			});
+	std::vector<int> duplicate_ids;
+	for (auto group_begin = entries.begin(); group_begin != entries.end();) {
+		const auto group_end = std::find_if(group_begin, entries.end(),
+				[&](const Entry &entry) {
+					return !(entry.fingerprint == group_begin->fingerprint);
+				});
+		// Almost always all documents of a group are equal, unless two term
+		// sets collide
+		for (auto it = group_begin; it != group_end; ++it) {
+			if (std::any_of(group_begin, it, [&](const Entry &kept) {
+				return kept.term_ids == it->term_ids;
+			})) {
+				duplicate_ids.push_back(it->document_id);
+			}
+		}
+		group_begin = group_end;
+	}
+	std::sort(duplicate_ids.begin(), duplicate_ids.end());
+	search_server.RemoveDocuments(policy, duplicate_ids);
+	return duplicate_ids;
+}
@@ -11,10 +11,10 @@ RequestQueue::RequestQueue(const SearchServer &search_server) :
 		search_server_(search_server) {
 }
 vector<Document> RequestQueue::AddFindRequest(const string &raw_query, DocumentStatus status) {
-	return AddFindRequest(
-			raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-				return document_status == status;
-			});
+	// Goes through the status overload, which may be served by the query cache
+	vector<Document> results = search_server_.FindTopDocuments(raw_query, status);
+	RecordRequest(raw_query, results.empty());
+	return results;
 }
 vector<Document> RequestQueue::AddFindRequest(const string &raw_query) {
 	return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
@@ -22,3 +22,15 @@ vector<Document> RequestQueue::AddFindRequest(const string &raw_query) {
 int RequestQueue::GetNoResultRequests() const {
 	return empty_requests_;
 }
+void RequestQueue::RecordRequest(const string &raw_query, bool empty_result) {
+	requests_.push_back( { raw_query, empty_result });
+	if (empty_result) {
+		++empty_requests_;
+	}
+	if (requests_.size() > min_in_day_) {
+		if (requests_.front().empty_result) {
+			--empty_requests_;
+		}
+		requests_.pop_front();
+	}
+}
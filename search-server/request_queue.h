@@ -19,6 +19,8 @@ private:
 		std::string raw_query_;
 		bool empty_result;
 	};
+	void RecordRequest(const std::string &raw_query, bool empty_result);
+
 	std::deque<QueryResult> requests_;
 	const static int min_in_day_ = 1440;
 	int empty_requests_ = 0;
@@ -27,21 +29,7 @@ private:
 
 template<typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query, DocumentPredicate document_predicate) {
-	std::vector<Document> results;
-	results = search_server_.FindTopDocuments(raw_query, document_predicate);
-	if (results.empty()) {
-		requests_.push_back( { raw_query, 1 });
-		++empty_requests_;
-	} else {
-		requests_.push_back( { raw_query, 0 });
-	}
-	if (requests_.size() > min_in_day_) {
-		if (requests_.front().empty_result) {
-			--empty_requests_;
-			requests_.pop_front();
-		} else {
-			requests_.pop_front();
-		}
-	}
+	std::vector<Document> results = search_server_.FindTopDocuments(raw_query, document_predicate);
+	RecordRequest(raw_query, results.empty());
 	return results;
 }
@@ -0,0 +1,23 @@
+#include "score_accumulator.h"
+
+void ScoreAccumulator::Reset(int begin, size_t size) {
+	Clear();
+	begin_ = begin;
+	if (scores_.size() < size) {
+		scores_.resize(size);
+		states_.resize(size, State::UNTOUCHED);
+	}
+}
+
+void ScoreAccumulator::Clear() {
+	for (size_t slot : touched_) {
+		scores_[slot] = 0.0;
+		states_[slot] = State::UNTOUCHED;
+	}
+	touched_.clear();
+}
+
+ScoreAccumulator& ScoreAccumulator::ForCurrentThread() {
+	thread_local ScoreAccumulator accumulator;
+	return accumulator;
+}
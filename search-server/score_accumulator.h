@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Dense per-query relevance storage for a contiguous range of document
+// indexes. Only touched slots are listed, so Clear costs O(matched documents)
+// instead of O(range size), and one accumulator can be reused across queries.
+class ScoreAccumulator {
+public:
+	// Prepares the accumulator for the range [begin, begin + size)
+	void Reset(int begin, size_t size);
+
+	void Add(int document_index, double score) {
+		const size_t slot = document_index - begin_;
+		if (states_[slot] == State::UNTOUCHED) {
+			touched_.push_back(slot);
+			states_[slot] = State::MATCHED;
+		}
+		scores_[slot] += score;
+	}
+
+	void Exclude(int document_index) {
+		const size_t slot = document_index - begin_;
+		if (states_[slot] == State::UNTOUCHED) {
+			touched_.push_back(slot);
+		}
+		states_[slot] = State::EXCLUDED;
+	}
+
+	bool IsExcluded(int document_index) const {
+		return states_[document_index - begin_] == State::EXCLUDED;
+	}
+
+	// Calls func(document_index, relevance) for every matched and not
+	// excluded document
+	template<typename Func>
+	void ForEachMatched(Func func) const {
+		for (size_t slot : touched_) {
+			if (states_[slot] == State::MATCHED) {
+				func(static_cast<int>(begin_ + slot), scores_[slot]);
+			}
+		}
+	}
+
+	void Clear();
+
+	// Per-thread instance reused by every query running on the thread
+	static ScoreAccumulator& ForCurrentThread();
+
+private:
+	enum class State : char {
+		UNTOUCHED, MATCHED, EXCLUDED,
+	};
+
+	int begin_ = 0;
+	std::vector<double> scores_;
+	std::vector<State> states_;
+	std::vector<size_t> touched_;
+};
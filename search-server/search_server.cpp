@@ -1,6 +1,6 @@
 #include "search_server.h"
 #include "string_processing.h"
-#include "concurrent_map.h"
+#include "index_snapshot.h"
 #include <algorithm>
 #include <stdexcept>
 #include <vector>
@@ -10,6 +10,44 @@
 #include <map>
 #include <execution>
 #include <cassert>
+#include <fstream>
+#include <iterator>
+
+namespace {
+// Rough per-node costs of the standard containers: the value plus
+// parent/left/right links and colour for std::map and std::set,
+// the value plus the next link and cached hash for std::unordered_map
+const size_t MAP_NODE_BYTES = 4 * sizeof(void*) + 2 * sizeof(double);
+const size_t HASH_NODE_BYTES = 2 * sizeof(void*) + 2 * sizeof(int);
+}
+
+SearchStop::SearchStop(std::function<bool()> condition) :
+		condition_(std::move(condition)) {
+}
+
+bool SearchStop::ShouldStop() const {
+	if (stopped_.load(std::memory_order_relaxed)) {
+		return true;
+	}
+	if (condition_ && condition_()) {
+		stopped_.store(true, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+bool SearchStop::IsStopped() const {
+	return stopped_.load(std::memory_order_relaxed);
+}
+
+size_t IndexMemoryUsage::GetTotalBytes() const {
+	return document_arena_bytes + dictionary_bytes + posting_bytes
+			+ document_data_bytes + forward_index_bytes + champion_list_bytes;
+}
+
+double IndexMemoryUsage::GetBytesPerPosting() const {
+	return posting_count == 0 ? 0.0 : posting_bytes * 1.0 / posting_count;
+}
 
 SearchServer::SearchServer(const std::string &stop_words_text) :
 		SearchServer(std::string_view(stop_words_text)) // Invoke delegating constructor from string container
@@ -23,51 +61,235 @@ SearchServer::SearchServer(std::string_view stop_words_text) :
 
 void SearchServer::AddDocument(int document_id, std::string_view document,
 		DocumentStatus status, const std::vector<int> &ratings) {
-	if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+	CheckNewDocumentId(document_id);
+	const ParsedDocument parsed_document = ParseDocument(document);
+	if (!parsed_document.is_valid) {
+		throw invalid_argument("Word "s
+				+ std::string(parsed_document.invalid_word) + " is invalid"s);
+	}
+	IndexDocument(document_id, document, status, ratings, parsed_document);
+}
+
+void SearchServer::AddDocuments(const std::vector<NewDocument> &documents) {
+	AddDocuments(std::execution::seq, documents);
+}
+
+void SearchServer::CheckNewDocumentId(int document_id) const {
+	if ((document_id < 0) || (document_id_to_index_.count(document_id) > 0)) {
 		throw invalid_argument("Invalid document_id"s);
 	}
-	const auto words = SplitIntoWordsNoStop(document);
+}
 
-	const double inv_word_count = 1.0 / words.size();
-	for (std::string_view word : words) {
-		word_to_document_freqs_[std::string(
-				word)][document_id] += inv_word_count;
+void SearchServer::IndexDocument(int document_id, std::string_view document,
+		DocumentStatus status, const std::vector<int> &ratings,
+		const ParsedDocument &parsed_document) {
+	const int document_index = documents_.size();
+	thread_local std::vector<std::pair<TermId, int>> terms;
+	terms.clear();
+	for (const auto &[word, term_count] : parsed_document.word_counts) {
+		const TermId term_id = dictionary_.Intern(word);
+		if (static_cast<size_t>(term_id) == postings_.size()) {
+			postings_.emplace_back();
+			if (compress_postings_) {
+				postings_.back().postings.Compress();
+			}
+		}
+		PostingList &posting_list = postings_[term_id];
+		posting_list.postings.Append(document_index, term_count);
+		posting_list.champions.Insert(document_index,
+				term_count * parsed_document.inv_word_count);
+		terms.emplace_back(term_id, term_count);
 	}
-	for (std::string_view word : words) {
-		word_frequencies_[document_id][word] =
-				word_to_document_freqs_[std::string(
-						word)][document_id];
+	std::sort(terms.begin(), terms.end());
+	const size_t terms_begin = document_terms_.size();
+	for (const auto &[term_id, term_count] : terms) {
+		document_terms_.push_back(term_id);
+		document_term_counts_.push_back(term_count);
 	}
-	documents_.emplace(document_id,
-			DocumentData { ComputeAverageRating(ratings), status });
+	const std::string_view text = document_texts_.Store(document);
+	document_text_bytes_ += text.size();
+	documents_.push_back(
+			DocumentData { document_id, ComputeAverageRating(ratings), status,
+					text, parsed_document.inv_word_count, terms_begin,
+					document_terms_.size() });
+	document_id_to_index_.emplace(document_id, document_index);
 	document_ids_.insert(document_id);
+	++index_epoch_;
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(
-		int document_id) const {
-	if (word_frequencies_.count(document_id)) {
-		return word_frequencies_.at(document_id);
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+	const auto index_it = document_id_to_index_.find(document_id);
+	if (index_it == document_id_to_index_.end()) {
+		return {};
 	}
-	return empty_map_;
+	const DocumentData &document_data = documents_[index_it->second];
+	return {dictionary_, document_terms_.data() + document_data.terms_begin,
+			document_term_counts_.data() + document_data.terms_begin,
+			document_data.terms_end - document_data.terms_begin,
+			document_data.inv_word_count};
 }
 
-void SearchServer::RemoveDocument(int document_id) {
-	auto words_to_del = GetWordFrequencies(document_id);
-	for (const auto &word : words_to_del) {
-		word_to_document_freqs_.at(std::string(word.first)).erase(document_id);
+std::vector<TermId> SearchServer::GetDocumentTermIds(int document_id) const {
+	const auto index_it = document_id_to_index_.find(document_id);
+	if (index_it == document_id_to_index_.end()) {
+		return {};
 	}
-	documents_.erase(document_id);
-	document_ids_.erase(document_id);
-	word_frequencies_.erase(document_id);
+	const DocumentData &document_data = documents_[index_it->second];
+	return {document_terms_.begin() + document_data.terms_begin,
+			document_terms_.begin() + document_data.terms_end};
+}
+
+std::string_view SearchServer::GetDocumentText(int document_id) const {
+	return documents_[document_id_to_index_.at(document_id)].text;
+}
+
+IndexMemoryUsage SearchServer::GetMemoryUsage() const {
+	IndexMemoryUsage usage;
+	usage.document_text_bytes = document_text_bytes_;
+	usage.document_arena_bytes = document_texts_.GetReservedBytes();
+	usage.dictionary_bytes = dictionary_.GetMemoryUsage();
+	usage.posting_bytes = postings_.capacity() * sizeof(PostingList);
+	for (const auto &posting_list : postings_) {
+		usage.posting_bytes += posting_list.postings.GetMemoryUsage();
+		usage.posting_count += posting_list.postings.size();
+		usage.champion_list_bytes += posting_list.champions.GetMemoryUsage();
+	}
+	usage.document_data_bytes = documents_.capacity() * sizeof(DocumentData)
+			+ document_id_to_index_.bucket_count() * sizeof(void*)
+			+ document_id_to_index_.size() * HASH_NODE_BYTES
+			+ document_ids_.size() * MAP_NODE_BYTES;
+	usage.forward_index_bytes = document_terms_.capacity() * sizeof(TermId)
+			+ document_term_counts_.capacity() * sizeof(int);
+	return usage;
+}
+
+void SearchServer::SaveSnapshot(const std::string &path) const {
+	SnapshotHeader header { };
+	std::copy(std::begin(SNAPSHOT_MAGIC), std::end(SNAPSHOT_MAGIC),
+			header.magic);
+	header.version = SNAPSHOT_VERSION;
+
+	// Documents are renumbered in the order of their ids, dropping the slots
+	// of removed documents
+	std::vector<SnapshotDocument> documents;
+	std::vector<int> snapshot_indexes(documents_.size());
+	documents.reserve(document_ids_.size());
+	for (int document_id : document_ids_) {
+		const int document_index = document_id_to_index_.at(document_id);
+		const DocumentData &document_data = documents_[document_index];
+		snapshot_indexes[document_index] = documents.size();
+		documents.push_back( { document_data.id, document_data.rating,
+				static_cast<int32_t>(document_data.status), 0 });
+	}
+
+	std::string chars;
+	std::vector<TermId> term_ids;
+	for (TermId term_id = 0; term_id < static_cast<TermId>(postings_.size());
+			++term_id) {
+		if (!postings_[term_id].postings.empty()) {
+			term_ids.push_back(term_id);
+		}
+	}
+	std::sort(term_ids.begin(), term_ids.end(), [this](TermId lhs, TermId rhs) {
+		return dictionary_.GetTerm(lhs) < dictionary_.GetTerm(rhs);
+	});
+	std::vector<SnapshotTerm> terms;
+	std::vector<SnapshotPosting> postings;
+	terms.reserve(term_ids.size());
+	for (TermId term_id : term_ids) {
+		const PostingList &posting_list = postings_[term_id];
+		const std::string_view word = dictionary_.GetTerm(term_id);
+		terms.push_back( { { chars.size(), word.size() }, postings.size(),
+				posting_list.postings.size(), ComputeWordInverseDocumentFreq(
+						posting_list), static_cast<uint64_t>(term_id) });
+		chars += word;
+		const size_t first_posting = postings.size();
+		posting_list.postings.ForEach(
+				[&](int document_index, int term_count) {
+					postings.push_back( { snapshot_indexes[document_index], 0,
+							term_count * documents_[document_index].inv_word_count });
+				});
+		std::sort(postings.begin() + first_posting, postings.end(),
+				[](const SnapshotPosting &lhs, const SnapshotPosting &rhs) {
+					return lhs.document_index < rhs.document_index;
+				});
+	}
+	std::vector<SnapshotString> stop_words;
+	for (const std::string &stop_word : stop_words_) {
+		stop_words.push_back( { chars.size(), stop_word.size() });
+		chars += stop_word;
+	}
+
+	uint64_t offset = sizeof(SnapshotHeader);
+	const auto place = [&offset](uint64_t &section_offset, size_t bytes) {
+		section_offset = offset;
+		offset += (bytes + alignof(uint64_t) - 1) / alignof(uint64_t)
+				* alignof(uint64_t);
+	};
+	header.document_count = documents.size();
+	header.term_count = terms.size();
+	header.posting_count = postings.size();
+	header.stop_word_count = stop_words.size();
+	header.chars_size = chars.size();
+	place(header.documents_offset, documents.size() * sizeof(SnapshotDocument));
+	place(header.terms_offset, terms.size() * sizeof(SnapshotTerm));
+	place(header.postings_offset, postings.size() * sizeof(SnapshotPosting));
+	place(header.stop_words_offset, stop_words.size() * sizeof(SnapshotString));
+	place(header.chars_offset, chars.size());
+	header.file_size = offset;
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	const auto write_section = [&out](uint64_t section_offset, const void *data,
+			size_t bytes) {
+		out.seekp(section_offset);
+		out.write(static_cast<const char*>(data), bytes);
+	};
+	write_section(0, &header, sizeof(header));
+	write_section(header.documents_offset, documents.data(),
+			documents.size() * sizeof(SnapshotDocument));
+	write_section(header.terms_offset, terms.data(),
+			terms.size() * sizeof(SnapshotTerm));
+	write_section(header.postings_offset, postings.data(),
+			postings.size() * sizeof(SnapshotPosting));
+	write_section(header.stop_words_offset, stop_words.data(),
+			stop_words.size() * sizeof(SnapshotString));
+	write_section(header.chars_offset, chars.data(), chars.size());
+	// Pad the file up to the size recorded in the header
+	if (header.file_size > header.chars_offset + chars.size()) {
+		out.seekp(header.file_size - 1);
+		out.put('\0');
+	}
+	if (!out) {
+		throw std::runtime_error("Cannot write index snapshot "s + path);
+	}
+}
+
+DocumentMemoryUsage SearchServer::GetDocumentMemoryUsage(
+		int document_id) const {
+	DocumentMemoryUsage usage;
+	usage.text_bytes = GetDocumentText(document_id).size();
+	const auto index_it = document_id_to_index_.find(document_id);
+	const size_t word_count = index_it == document_id_to_index_.end() ? 0 :
+			documents_[index_it->second].terms_end
+					- documents_[index_it->second].terms_begin;
+	usage.posting_bytes = word_count * sizeof(Posting);
+	usage.forward_index_bytes = word_count * (sizeof(TermId) + sizeof(int));
+	return usage;
+}
+
+void SearchServer::RemoveDocument(int document_id) {
+	RemoveDocument(std::execution::seq, document_id);
+}
+
+void SearchServer::RemoveDocuments(const std::vector<int> &document_ids) {
+	RemoveDocuments(std::execution::seq, document_ids);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(
-		std::string_view raw_query, DocumentStatus status) const {
-	return FindTopDocuments(std::execution::seq, raw_query,
-			[status](int document_id, DocumentStatus document_status,
-					int rating) {
-				return document_status == status;
-			});
+		std::string_view raw_query, DocumentStatus status,
+		size_t max_result_count) const {
+	return FindTopDocuments(std::execution::seq, raw_query, status,
+			max_result_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(
@@ -75,8 +297,105 @@ std::vector<Document> SearchServer::FindTopDocuments(
 	return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
 }
 
+const std::vector<Document>& SearchServer::FindTopDocuments(
+		std::string_view raw_query, DocumentStatus status,
+		QueryScratch &scratch, size_t max_result_count) const {
+	if (query_cache_ != nullptr) {
+		scratch.result_ = FindTopDocuments(raw_query, status, max_result_count);
+		return scratch.result_;
+	}
+	ParseQuery(raw_query, scratch.query_, true);
+	ComputeInverseDocumentFreqs(scratch.query_, scratch.inverse_document_freqs_);
+	const auto status_predicate = [status](int document_id,
+			DocumentStatus document_status, int rating) {
+		return document_status == status;
+	};
+	// The heap keeps the same documents as the selection of the exhaustive
+	// search, since documents are ordered without ties
+	scratch.top_documents_.Reset(max_result_count);
+	if (dynamic_pruning_) {
+		FindTopDocumentsInRange(scratch.query_, scratch.inverse_document_freqs_,
+				status_predicate, 0, documents_.size(), scratch.top_documents_,
+				SearchStop());
+	} else {
+		scratch.matched_documents_.clear();
+		FindDocumentsInRange(scratch.query_, scratch.inverse_document_freqs_,
+				status_predicate, 0, documents_.size(),
+				scratch.matched_documents_, SearchStop());
+		for (const Document &document : scratch.matched_documents_) {
+			scratch.top_documents_.Add(document);
+		}
+	}
+	scratch.top_documents_.ExtractTo(scratch.result_);
+	return scratch.result_;
+}
+
 int SearchServer::GetDocumentCount() const {
-	return documents_.size();
+	return document_ids_.size();
+}
+
+DocumentStatus SearchServer::GetDocumentStatus(int document_id) const {
+	return documents_[document_id_to_index_.at(document_id)].status;
+}
+
+int SearchServer::GetDocumentRating(int document_id) const {
+	return documents_[document_id_to_index_.at(document_id)].rating;
+}
+
+void SearchServer::SetParallelWorkerCount(size_t worker_count) {
+	parallel_worker_count_ = std::max<size_t>(1, worker_count);
+}
+
+void SearchServer::PrecomputeInverseDocumentFreqs() const {
+	PrecomputeInverseDocumentFreqs(std::execution::seq);
+}
+
+void SearchServer::SetPostingCompression(bool enabled) {
+	compress_postings_ = enabled;
+	for (PostingList &posting_list : postings_) {
+		if (enabled) {
+			posting_list.postings.Compress();
+		} else {
+			posting_list.postings.Decompress();
+		}
+	}
+}
+
+void SearchServer::SetDynamicPruning(bool enabled) {
+	dynamic_pruning_ = enabled;
+}
+
+void SearchServer::SetQueryCacheCapacity(size_t capacity) {
+	if (capacity == 0) {
+		query_cache_.reset();
+	} else {
+		query_cache_ = std::make_unique<QueryCache>(capacity);
+	}
+}
+
+QueryCacheStats SearchServer::GetQueryCacheStats() const {
+	if (query_cache_ == nullptr) {
+		return {};
+	}
+	return query_cache_->GetStats();
+}
+
+std::string SearchServer::MakeQueryCacheKey(const Query &query,
+		DocumentStatus status, size_t max_result_count) {
+	std::string key;
+	const auto append = [&key](const auto &value) {
+		key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	};
+	append(status);
+	append(max_result_count);
+	append(query.plus_terms.size());
+	for (TermId term_id : query.plus_terms) {
+		append(term_id);
+	}
+	for (TermId term_id : query.minus_terms) {
+		append(term_id);
+	}
+	return key;
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
@@ -84,32 +403,45 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 	if (raw_query.empty()) {
 		throw std::invalid_argument("");
 	}
-	if (document_ids_.count(document_id) == 0) {
+	const int document_index = GetDocumentIndex(document_id);
+	return {MatchDocumentTerms(ParseQuery(raw_query, true), document_index),
+			documents_[document_index].status};
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(
+		std::string_view raw_query,
+		const std::vector<int> &document_ids) const {
+	return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+int SearchServer::GetDocumentIndex(int document_id) const {
+	const auto index_it = document_id_to_index_.find(document_id);
+	if (index_it == document_id_to_index_.end()) {
 		throw std::out_of_range("");
 	}
-	auto query = ParseQuery(raw_query, true);
-	std::vector<std::string_view> matched_words;
-	for (std::string_view word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
-		}
-		if (word_to_document_freqs_.at(std::string(word)).count(document_id)) {
-			return {matched_words, documents_.at(document_id).status};
-		}
-	}
-	for (std::string_view word : query.plus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
-		}
-		if (word_to_document_freqs_.at(std::string(word)).count(document_id)) {
-			matched_words.push_back((*word_to_document_freqs_.find(word)).first);
+	return index_it->second;
+}
+
+std::vector<std::string_view> SearchServer::MatchDocumentTerms(
+		const Query &query, int document_index) const {
+	const DocumentData &document_data = documents_[document_index];
+	const auto terms_begin = document_terms_.begin() + document_data.terms_begin;
+	const auto terms_end = document_terms_.begin() + document_data.terms_end;
+	// Both sides are sorted by term id, so a minus word is found by a merge
+	auto term_it = terms_begin;
+	for (TermId term_id : query.minus_terms) {
+		term_it = std::lower_bound(term_it, terms_end, term_id);
+		if (term_it != terms_end && *term_it == term_id) {
+			return {};
 		}
 	}
-	return {matched_words, documents_.at(document_id).status};
+	thread_local std::vector<TermId> matched_terms;
+	matched_terms.clear();
+	std::set_intersection(query.plus_terms.begin(), query.plus_terms.end(),
+			terms_begin, terms_end, std::back_inserter(matched_terms));
+	return GetSortedTerms(matched_terms);
 }
 
-
-
 bool SearchServer::IsStopWord(std::string_view word) const {
 	return stop_words_.count(word) > 0;
 }
@@ -120,18 +452,28 @@ bool SearchServer::IsValidWord(std::string_view word) {
 	});
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(
+SearchServer::ParsedDocument SearchServer::ParseDocument(
 		std::string_view text) const {
-	std::vector<std::string_view> words;
-	for (std::string_view word : SplitIntoWords(text)) {
-		if (!IsValidWord(word)) {
-			throw invalid_argument("Word "s + std::string(word) + " is invalid"s);
-		}
-		if (!IsStopWord(word)) {
-			words.push_back(word);
-		}
+	ParsedDocument parsed_document;
+	thread_local std::vector<std::string_view> words;
+	words.clear();
+	if (!SplitIntoWords(text, words)) {
+		parsed_document.is_valid = false;
+		parsed_document.invalid_word = words.back();
+		return parsed_document;
 	}
-	return words;
+	words.erase(std::remove_if(words.begin(), words.end(),
+			[this](std::string_view word) {
+				return IsStopWord(word);
+			}), words.end());
+	std::sort(words.begin(), words.end());
+	parsed_document.inv_word_count = 1.0 / words.size();
+	for (auto it = words.begin(); it != words.end();) {
+		const auto word_end = std::upper_bound(it, words.end(), *it);
+		parsed_document.word_counts.emplace_back(*it, word_end - it);
+		it = word_end;
+	}
+	return parsed_document;
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int> &ratings) {
@@ -152,7 +494,8 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(
 		is_minus = true;
 		word = word.substr(1);
 	}
-	if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+	// Control characters are rejected by the tokenizer
+	if (word.empty() || word[0] == '-') {
 		throw invalid_argument("Query word "s + std::string(text) + " is invalid");
 	}
 	return {word, is_minus, IsStopWord(word)};
@@ -160,34 +503,224 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(
 
 SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool NeedSort) const {
 	Query query;
-	for (std::string_view word : SplitIntoWords(text)) {
+	ParseQuery(text, query, NeedSort);
+	return query;
+}
+
+void SearchServer::ParseQuery(std::string_view text, Query &query,
+		bool NeedSort) const {
+	query.plus_terms.clear();
+	query.minus_terms.clear();
+	thread_local std::vector<std::string_view> words;
+	words.clear();
+	if (!SplitIntoWords(text, words)) {
+		throw invalid_argument("Query word "s + std::string(words.back())
+				+ " is invalid");
+	}
+	for (std::string_view word : words) {
 		const auto query_word = ParseQueryWord(word);
-		if (!query_word.is_stop) {
-			if (query_word.is_minus) {
-				query.minus_words.push_back(query_word.data);
-			} else {
-				query.plus_words.push_back(query_word.data);
-			}
+		if (query_word.is_stop) {
+			continue;
+		}
+		const TermId term_id = dictionary_.Find(query_word.data);
+		if (term_id == TermDictionary::NO_TERM) {
+			continue;
+		}
+		if (query_word.is_minus) {
+			query.minus_terms.push_back(term_id);
+		} else {
+			query.plus_terms.push_back(term_id);
 		}
 	}
 	if (NeedSort) {
-		std::sort(query.minus_words.begin(), query.minus_words.end());
-		std::sort(query.plus_words.begin(), query.plus_words.end());
-		auto last_minus = std::unique(query.minus_words.begin(),
-				query.minus_words.end());
-		auto last_plus = std::unique(query.plus_words.begin(),
-				query.plus_words.end());
-		query.minus_words.erase(last_minus, query.minus_words.end());
-		query.plus_words.erase(last_plus, query.plus_words.end());
-		return query;
+		std::sort(query.minus_terms.begin(), query.minus_terms.end());
+		std::sort(query.plus_terms.begin(), query.plus_terms.end());
+		auto last_minus = std::unique(query.minus_terms.begin(),
+				query.minus_terms.end());
+		auto last_plus = std::unique(query.plus_terms.begin(),
+				query.plus_terms.end());
+		query.minus_terms.erase(last_minus, query.minus_terms.end());
+		query.plus_terms.erase(last_plus, query.plus_terms.end());
 	}
-	return query;
 }
 
 double SearchServer::ComputeWordInverseDocumentFreq(
-		std::string_view word) const {
-	return log(
-			GetDocumentCount() * 1.0 / word_to_document_freqs_.at(std::string(word)).size());
+		const PostingList &posting_list) const {
+	if (posting_list.idf_epoch.load(std::memory_order_acquire) == index_epoch_) {
+		return posting_list.inverse_document_freq.load(
+				std::memory_order_relaxed);
+	}
+	const double inverse_document_freq = log(
+			GetDocumentCount() * 1.0 / posting_list.postings.size());
+	posting_list.inverse_document_freq.store(inverse_document_freq,
+			std::memory_order_relaxed);
+	posting_list.idf_epoch.store(index_epoch_, std::memory_order_release);
+	return inverse_document_freq;
 }
 
+std::vector<double> SearchServer::ComputeInverseDocumentFreqs(
+		const Query &query) const {
+	std::vector<double> inverse_document_freqs;
+	ComputeInverseDocumentFreqs(query, inverse_document_freqs);
+	return inverse_document_freqs;
+}
+
+void SearchServer::ComputeInverseDocumentFreqs(const Query &query,
+		std::vector<double> &inverse_document_freqs) const {
+	inverse_document_freqs.clear();
+	inverse_document_freqs.reserve(query.plus_terms.size());
+	for (TermId term_id : query.plus_terms) {
+		const PostingList &posting_list = postings_[term_id];
+		inverse_document_freqs.push_back(
+				posting_list.postings.empty() ?
+						0.0 : ComputeWordInverseDocumentFreq(posting_list));
+	}
+}
+
+void SearchServer::RebuildChampionList(PostingList &posting_list) const {
+	ChampionList &champions = posting_list.champions;
+	champions.Clear();
+	posting_list.postings.ForEach([&](int document_index, int term_count) {
+		champions.Insert(document_index,
+				term_count * documents_[document_index].inv_word_count);
+	});
+}
 
+void SearchServer::CompactDocuments() {
+	std::vector<DocumentData> documents;
+	std::vector<TermId> document_terms;
+	std::vector<int> document_term_counts;
+	StringArena document_texts;
+	documents.reserve(document_ids_.size());
+	for (PostingList &posting_list : postings_) {
+		posting_list.postings = Postings();
+		if (compress_postings_) {
+			posting_list.postings.Compress();
+		}
+		posting_list.champions.Clear();
+	}
+	for (size_t old_index = 0; old_index < documents_.size(); ++old_index) {
+		DocumentData document_data = documents_[old_index];
+		const auto index_it = document_id_to_index_.find(document_data.id);
+		// The id of a removed document may be taken by a later one
+		if (index_it == document_id_to_index_.end()
+				|| index_it->second != static_cast<int>(old_index)) {
+			continue;
+		}
+		const int document_index = documents.size();
+		index_it->second = document_index;
+		const size_t terms_begin = document_terms.size();
+		for (size_t i = document_data.terms_begin; i < document_data.terms_end;
+				++i) {
+			const TermId term_id = document_terms_[i];
+			const int term_count = document_term_counts_[i];
+			PostingList &posting_list = postings_[term_id];
+			posting_list.postings.Append(document_index, term_count);
+			posting_list.champions.Insert(document_index,
+					term_count * document_data.inv_word_count);
+			document_terms.push_back(term_id);
+			document_term_counts.push_back(term_count);
+		}
+		document_data.terms_begin = terms_begin;
+		document_data.terms_end = document_terms.size();
+		document_data.text = document_texts.Store(document_data.text);
+		documents.push_back(document_data);
+	}
+	documents_ = std::move(documents);
+	document_terms_ = std::move(document_terms);
+	document_term_counts_ = std::move(document_term_counts);
+	document_texts_ = std::move(document_texts);
+}
+
+SearchServer::PostingList::PostingList(PostingList &&other) noexcept :
+		postings(std::move(other.postings)), champions(
+				std::move(other.champions)), inverse_document_freq(
+				other.inverse_document_freq.load()), idf_epoch(
+				other.idf_epoch.load()) {
+}
+
+SearchServer::QueryTermOrder SearchServer::SortQueryTerms(const Query &query) {
+	QueryTermOrder term_order;
+	term_order.reserve(query.plus_terms.size());
+	for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+		term_order.emplace_back(query.plus_terms[i], i);
+	}
+	std::sort(term_order.begin(), term_order.end());
+	return term_order;
+}
+
+double SearchServer::ComputeRelevance(const QueryTermOrder &term_order,
+		const std::vector<double> &inverse_document_freqs,
+		int document_index) const {
+	const DocumentData &document_data = documents_[document_index];
+	thread_local std::vector<std::pair<size_t, double>> contributions;
+	contributions.clear();
+	const auto add_contribution = [&](size_t term, size_t position) {
+		contributions.emplace_back(position,
+				document_term_counts_[term] * document_data.inv_word_count
+						* inverse_document_freqs[position]);
+	};
+	// Both the query terms and the document terms are sorted by term id. The
+	// shorter side is walked and the terms are looked up in the longer one
+	const size_t document_term_count = document_data.terms_end
+			- document_data.terms_begin;
+	if (term_order.size() < document_term_count) {
+		auto terms_it = document_terms_.begin() + document_data.terms_begin;
+		const auto terms_end = document_terms_.begin() + document_data.terms_end;
+		for (const auto &[term_id, position] : term_order) {
+			terms_it = std::lower_bound(terms_it, terms_end, term_id);
+			if (terms_it == terms_end) {
+				break;
+			}
+			if (*terms_it == term_id) {
+				add_contribution(terms_it - document_terms_.begin(), position);
+			}
+		}
+	} else {
+		auto term_it = term_order.begin();
+		for (size_t i = document_data.terms_begin; i < document_data.terms_end;
+				++i) {
+			term_it = std::lower_bound(term_it, term_order.end(),
+					std::make_pair(document_terms_[i], size_t { 0 }));
+			if (term_it == term_order.end()) {
+				break;
+			}
+			if (term_it->first == document_terms_[i]) {
+				add_contribution(i, term_it->second);
+			}
+		}
+	}
+	std::sort(contributions.begin(), contributions.end());
+	double relevance = 0.0;
+	for (const auto &[_, contribution] : contributions) {
+		relevance += contribution;
+	}
+	return relevance;
+}
+
+bool SearchServer::HasMinusTerm(const Query &query, int document_index) const {
+	const DocumentData &document_data = documents_[document_index];
+	const auto terms_begin = document_terms_.begin() + document_data.terms_begin;
+	const auto terms_end = document_terms_.begin() + document_data.terms_end;
+	return std::any_of(query.minus_terms.begin(), query.minus_terms.end(),
+			[&](TermId term_id) {
+				return std::binary_search(terms_begin, terms_end, term_id);
+			});
+}
+
+size_t SearchServer::CountNonEssentialTerms(
+		const std::vector<double> &bound_sums, double threshold) {
+	return std::lower_bound(bound_sums.begin(), bound_sums.end(), threshold)
+			- bound_sums.begin();
+}
+
+std::vector<std::string_view> SearchServer::GetSortedTerms(
+		const std::vector<TermId> &term_ids) const {
+	std::vector<std::string_view> terms(term_ids.size());
+	std::transform(term_ids.begin(), term_ids.end(), terms.begin(),
+			[this](TermId term_id) {
+				return dictionary_.GetTerm(term_id);
+			});
+	std::sort(terms.begin(), terms.end());
+	return terms;
+}
@@ -6,19 +6,80 @@
 #include <utility>
 #include <set>
 #include <map>
+#include <atomic>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
 #include <cmath>
 #include <execution>
 #include <string_view>
+#include <functional>
 #include <future>
+#include <optional>
+#include <memory>
+#include <limits>
 #include "document.h"
+#include "top_documents.h"
 #include "string_processing.h"
-#include "concurrent_map.h"
+#include "string_arena.h"
+#include "term_dictionary.h"
+#include "score_accumulator.h"
+#include "query_cache.h"
+#include "corpus_statistics.h"
+#include "postings.h"
+#include "champion_list.h"
+#include "word_frequencies.h"
 #include "log_duration.h"
 
 using namespace std;
 
-constexpr int CONCURRENT_MAP_DIVISION = 100;
-constexpr int COMPRASION_TOLERANCE = 1e-6;
+// Approximate heap footprint of the index. document_text_bytes counts texts of
+// documents still in the index and is a part of document_arena_bytes.
+struct IndexMemoryUsage {
+	size_t document_text_bytes = 0;
+	size_t document_arena_bytes = 0;
+	size_t dictionary_bytes = 0;
+	size_t posting_bytes = 0;
+	size_t posting_count = 0;
+	size_t document_data_bytes = 0;
+	size_t forward_index_bytes = 0;
+	size_t champion_list_bytes = 0;
+
+	size_t GetTotalBytes() const;
+	double GetBytesPerPosting() const;
+};
+
+struct DocumentMemoryUsage {
+	size_t text_bytes = 0;
+	size_t posting_bytes = 0;
+	size_t forward_index_bytes = 0;
+};
+
+struct NewDocument {
+	int id;
+	std::string_view text;
+	DocumentStatus status;
+	std::vector<int> ratings;
+};
+
+// Lets a caller abandon a search. The condition is polled between posting
+// lists and between windows of documents, never per document, and once it
+// returns true the search stops. Under a parallel policy it is polled from
+// several threads at once. A default constructed one never stops
+class SearchStop {
+public:
+	SearchStop() = default;
+	explicit SearchStop(std::function<bool()> condition);
+
+	// Polls the condition unless the search is already stopped
+	bool ShouldStop() const;
+
+	bool IsStopped() const;
+
+private:
+	std::function<bool()> condition_;
+	mutable std::atomic<bool> stopped_ = false;
+};
 
 class SearchServer {
 public:
@@ -32,6 +93,14 @@ public:
 	void AddDocument(int document_id, std::string_view document,
 			DocumentStatus status, const std::vector<int> &ratings);
 
+	// Tokenizes the documents in parallel under a parallel policy and then
+	// appends them to the index in the given order. Either all documents are
+	// added or, if some id or word is invalid, none of them
+	template<typename ExecutionPolicy>
+	void AddDocuments(const ExecutionPolicy &policy,
+			const std::vector<NewDocument> &documents);
+	void AddDocuments(const std::vector<NewDocument> &documents);
+
 	auto begin() const {
 		return document_ids_.begin();
 	}
@@ -41,8 +110,22 @@ public:
 	}
 	;
 
-	const std::map<std::string_view, double>& GetWordFrequencies(
-			int document_id) const;
+	// Empty for an unknown id
+	WordFrequencies GetWordFrequencies(int document_id) const;
+
+	// Ids of the document words in the dictionary, in ascending order
+	std::vector<TermId> GetDocumentTermIds(int document_id) const;
+
+	// Returns the copy of the document text owned by the server. The view is
+	// invalidated by removing documents, which may compact the index
+	std::string_view GetDocumentText(int document_id) const;
+
+	IndexMemoryUsage GetMemoryUsage() const;
+
+	// Writes the index in the format read by IndexSnapshot
+	void SaveSnapshot(const std::string &path) const;
+
+	DocumentMemoryUsage GetDocumentMemoryUsage(int document_id) const;
 
 	void RemoveDocument(int document_id);
 
@@ -50,30 +133,112 @@ public:
 	void RemoveDocument(const ExecutionPolicy &policy,
 			int document_id);
 
+	// Removes all the documents in one pass over every affected posting list.
+	// Posting lists of different terms are updated in parallel under a
+	// parallel policy. Unknown ids are skipped. Once removed documents take
+	// more than half of the document slots, the index is compacted: the
+	// slots, forward index entries and texts of removed documents are
+	// released. Words of removed documents stay in the term dictionary
+	template<typename ExecutionPolicy>
+	void RemoveDocuments(const ExecutionPolicy &policy,
+			const std::vector<int> &document_ids);
+	void RemoveDocuments(const std::vector<int> &document_ids);
+
 	template<typename DocumentPredicate>
 	std::vector<Document> FindTopDocuments(std::string_view raw_query,
-			DocumentPredicate document_predicate) const;
+			DocumentPredicate document_predicate,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
 	std::vector<Document> FindTopDocuments(std::string_view raw_query,
-			DocumentStatus status) const;
+			DocumentStatus status,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
 	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
+	// Buffers of a sequential search: the parsed query, its IDFs, the matched
+	// documents and the top documents heap. A thread running many queries
+	// keeps one and passes it to every search, so the buffers grow to the
+	// largest query once and are only cleared afterwards
+	class QueryScratch;
+
+	// Same as the sequential FindTopDocuments filtering by status. Returns
+	// the documents held by the scratch, valid until its next use
+	const std::vector<Document>& FindTopDocuments(std::string_view raw_query,
+			DocumentStatus status, QueryScratch &scratch,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
 	template<typename DocumentPredicate, typename ExecutionPolicy>
 	std::vector<Document> FindTopDocuments(const ExecutionPolicy &policy,
 			std::string_view raw_query,
-			DocumentPredicate document_predicate) const;
+			DocumentPredicate document_predicate,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 	template<typename ExecutionPolicy>
 	std::vector<Document> FindTopDocuments(
 			const ExecutionPolicy &policy,
-			std::string_view raw_query, DocumentStatus status) const;
+			std::string_view raw_query, DocumentStatus status,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 	template<typename ExecutionPolicy>
 	std::vector<Document> FindTopDocuments(
 			const ExecutionPolicy &policy,
 			std::string_view raw_query) const;
 
+	// Same as FindTopDocuments filtering by status, query cache included, but
+	// returns nothing if the search is stopped before it completes
+	template<typename ExecutionPolicy>
+	std::optional<std::vector<Document>> TryFindTopDocuments(
+			const ExecutionPolicy &policy, std::string_view raw_query,
+			DocumentStatus status, const SearchStop &stop,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	// Scores with the IDFs of a larger corpus this server is a part of
+	// instead of its own ones. Terms are summed in the order of the corpus
+	// term ids, so relevance is exactly the one a single server holding the
+	// whole corpus would compute
+	template<typename ExecutionPolicy, typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy &policy,
+			std::string_view raw_query, DocumentPredicate document_predicate,
+			const CorpusStatistics &statistics,
+			size_t max_result_count) const;
+
 	int GetDocumentCount() const;
 
+	DocumentStatus GetDocumentStatus(int document_id) const;
+
+	int GetDocumentRating(int document_id) const;
+
+	// Number of parts the document range is split into by the parallel
+	// versions of FindTopDocuments. Defaults to the number of hardware threads
+	void SetParallelWorkerCount(size_t worker_count);
+
+	// IDFs are cached per term and recomputed lazily by the first query after
+	// the document count changes. Call this after a bulk load to compute all of
+	// them at once instead
+	template<typename ExecutionPolicy>
+	void PrecomputeInverseDocumentFreqs(const ExecutionPolicy &policy) const;
+	void PrecomputeInverseDocumentFreqs() const;
+
+	// Switches every posting list, and the ones created later, between the
+	// plain and the compressed layout. Compressed lists take several times
+	// less memory and are decoded block by block while scoring. Relevance
+	// does not depend on the layout
+	void SetPostingCompression(bool enabled);
+
+	// Makes FindTopDocuments score document at a time and skip documents
+	// whose upper bound of relevance cannot get them into the result
+	// (MaxScore). Documents of the champion lists of the query terms are
+	// scored first, which answers most single-term queries without reading
+	// the postings. The result is the same as with exhaustive scoring.
+	// Off by default: it pays off for queries of one or two words, while
+	// long queries leave little to skip and run slower than exhaustive
+	// scoring
+	void SetDynamicPruning(bool enabled);
+
+	// Caches results of FindTopDocuments calls filtering by status, keyed by
+	// the parsed query. Entries are invalidated by any change of the index.
+	// Capacity 0 disables the cache, which is the default
+	void SetQueryCacheCapacity(size_t capacity);
+	QueryCacheStats GetQueryCacheStats() const;
+
 	int GetDocumentId(int index) const;
 
 	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
@@ -84,49 +249,217 @@ public:
 			const ExecutionPolicy &policy,
 			std::string_view raw_query, int document_id) const;
 
+	// Matches the query against every document in the list, parsing it once.
+	// Documents are matched in parallel under a parallel policy
+	template<typename ExecutionPolicy>
+	std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+			const ExecutionPolicy &policy, std::string_view raw_query,
+			const std::vector<int> &document_ids) const;
+	std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+			std::string_view raw_query,
+			const std::vector<int> &document_ids) const;
+
 private:
 	struct DocumentData {
+		int id;
 		int rating;
 		DocumentStatus status;
+		std::string_view text;
+		// Term frequency of a word is its count times this
+		double inv_word_count;
+		// Position of the document terms in document_terms_
+		size_t terms_begin;
+		size_t terms_end;
+	};
+
+	// Posting lists are kept sorted by document_index, which is the position
+	// of the document in documents_
+	struct PostingList {
+		PostingList() = default;
+		PostingList(PostingList &&other) noexcept;
+
+		Postings postings;
+		ChampionList champions;
+		// IDF computed for the index epoch stored in idf_epoch. Atomics let
+		// concurrent queries refresh the cache of the same term
+		mutable std::atomic<double> inverse_document_freq = 0.0;
+		mutable std::atomic<uint64_t> idf_epoch = 0;
 	};
 
+	// Words of a document with their counts, sorted by word. Parsing does not
+	// touch the index, so documents may be parsed in parallel
+	struct ParsedDocument {
+		std::vector<std::pair<std::string_view, int>> word_counts;
+		double inv_word_count = 0.0;
+		std::string_view invalid_word;
+		bool is_valid = true;
+	};
+
+	// A term and the index of a document to remove from its postings
+	using RemovedPosting = std::pair<TermId, int>;
+
 	struct QueryWord {
 		std::string_view data;
 		bool is_minus;
 		bool is_stop;
 	};
 
+	// Query words are resolved to term ids while parsing. Words missing from
+	// the dictionary cannot match any document and are dropped.
 	struct Query {
-		std::vector<std::string_view> plus_words;
-		std::vector<std::string_view> minus_words;
+		std::vector<TermId> plus_terms;
+		std::vector<TermId> minus_terms;
 	};
 
 	const std::set<std::string, std::less<>> stop_words_;
-	std::map<std::string, std::map<int, double>, std::less<>> word_to_document_freqs_;
-	std::map<int, DocumentData> documents_;
+	StringArena document_texts_;
+	size_t document_text_bytes_ = 0;
+	TermDictionary dictionary_;
+	std::vector<PostingList> postings_;
+	// Bumped whenever the document count changes, which makes every cached
+	// IDF stale
+	uint64_t index_epoch_ = 1;
+	std::vector<DocumentData> documents_;
+	// Forward index: term ids of every document sorted in ascending order,
+	// stored one document after another, and the counts of the terms in the
+	// document. It is the only per-document copy of the words
+	std::vector<TermId> document_terms_;
+	std::vector<int> document_term_counts_;
+	std::unordered_map<int, int> document_id_to_index_;
 	std::set<int> document_ids_;
-	std::map<int, std::map<std::string_view, double>, std::less<>> word_frequencies_;
-	std::map<std::string_view, double> empty_map_;
+	size_t parallel_worker_count_ = std::max(1u,
+			std::thread::hardware_concurrency());
+	std::unique_ptr<QueryCache> query_cache_;
+	bool compress_postings_ = false;
+	bool dynamic_pruning_ = false;
 
 	bool IsStopWord(std::string_view word) const;
 	static bool IsValidWord(std::string_view word);
-	std::vector<std::string_view> SplitIntoWordsNoStop(
-			std::string_view text) const;
+	ParsedDocument ParseDocument(std::string_view text) const;
+	void CheckNewDocumentId(int document_id) const;
+	void IndexDocument(int document_id, std::string_view document,
+			DocumentStatus status, const std::vector<int> &ratings,
+			const ParsedDocument &parsed_document);
 	static int ComputeAverageRating(const std::vector<int> &ratings);
 	QueryWord ParseQueryWord(std::string_view text) const;
 	Query ParseQuery(std::string_view text, bool NeedSort = false) const;
-	double ComputeWordInverseDocumentFreq(std::string_view word) const;
+	// Same as above, reusing the vectors of the query
+	void ParseQuery(std::string_view text, Query &query,
+			bool NeedSort = false) const;
+	double ComputeWordInverseDocumentFreq(
+			const PostingList &posting_list) const;
+	void RebuildChampionList(PostingList &posting_list) const;
+	// Drops the slots of removed documents, renumbering the remaining ones in
+	// the same order, and rebuilds the posting lists, the forward index and
+	// the text arena over them
+	void CompactDocuments();
+	// IDFs of query.plus_terms in the same order
+	std::vector<double> ComputeInverseDocumentFreqs(const Query &query) const;
+	void ComputeInverseDocumentFreqs(const Query &query,
+			std::vector<double> &inverse_document_freqs) const;
+	std::vector<std::string_view> GetSortedTerms(
+			const std::vector<TermId> &term_ids) const;
+	// Throws out_of_range for an unknown id
+	int GetDocumentIndex(int document_id) const;
+	// Words of the query found in the document, sorted, or none if the
+	// document has a minus word. Expects the query terms to be sorted
+	std::vector<std::string_view> MatchDocumentTerms(const Query &query,
+			int document_index) const;
 
-	template<typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const Query &query,
-			DocumentPredicate document_predicate) const;
+	static std::string MakeQueryCacheKey(const Query &query,
+			DocumentStatus status, size_t max_result_count);
+
+	// The result of a stopped search is incomplete and must be dropped
+	template<typename ExecutionPolicy, typename DocumentPredicate>
+	std::vector<Document> FindTopDocumentsForQuery(
+			const ExecutionPolicy &policy, const Query &query,
+			DocumentPredicate document_predicate, size_t max_result_count,
+			const SearchStop &stop) const;
+	template<typename ExecutionPolicy, typename DocumentPredicate>
+	std::vector<Document> FindTopDocumentsForQuery(
+			const ExecutionPolicy &policy, const Query &query,
+			const std::vector<double> &inverse_document_freqs,
+			DocumentPredicate document_predicate, size_t max_result_count,
+			const SearchStop &stop) const;
 	template<typename DocumentPredicate>
 	std::vector<Document> FindAllDocuments(
 			const std::execution::sequenced_policy &policy, const Query &query,
-			DocumentPredicate document_predicate) const;
+			const std::vector<double> &inverse_document_freqs,
+			DocumentPredicate document_predicate, const SearchStop &stop) const;
 	template<typename DocumentPredicate>
 	std::vector<Document> FindAllDocuments(const std::execution::parallel_policy &policy, const Query &query,
-			DocumentPredicate document_predicate) const;
+			const std::vector<double> &inverse_document_freqs,
+			DocumentPredicate document_predicate, const SearchStop &stop) const;
+	template<typename DocumentPredicate>
+	std::vector<Document> FindTopDocumentsPruned(
+			const std::execution::sequenced_policy &policy, const Query &query,
+			const std::vector<double> &inverse_document_freqs,
+			DocumentPredicate document_predicate, size_t max_result_count,
+			const SearchStop &stop) const;
+	template<typename DocumentPredicate>
+	std::vector<Document> FindTopDocumentsPruned(
+			const std::execution::parallel_policy &policy, const Query &query,
+			const std::vector<double> &inverse_document_freqs,
+			DocumentPredicate document_predicate, size_t max_result_count,
+			const SearchStop &stop) const;
+	// Query plus terms sorted by term id, paired with their positions in the
+	// query
+	using QueryTermOrder = std::vector<std::pair<TermId, size_t>>;
+	static constexpr int MAX_SCORE_WINDOW_SIZE = 4096;
+	// Largest number of documents whose postings are scanned between checks
+	// of the stop condition. The pruned search checks it once a window
+	static constexpr int STOP_CHECK_INTERVAL = 16384;
+	// Longer queries are not seeded from the champion lists. Their results
+	// are rarely decided by the champions, and the threshold set by them
+	// makes MaxScore probe more postings than it skips
+	static constexpr size_t MAX_CHAMPION_QUERY_TERMS = 2;
+
+	static QueryTermOrder SortQueryTerms(const Query &query);
+	// Relevance of the document summed in the order of query.plus_terms,
+	// exactly as FindDocumentsInRange computes it
+	double ComputeRelevance(const QueryTermOrder &term_order,
+			const std::vector<double> &inverse_document_freqs,
+			int document_index) const;
+	bool HasMinusTerm(const Query &query, int document_index) const;
+	// Number of leading terms whose bounds sum to less than the threshold
+	static size_t CountNonEssentialTerms(const std::vector<double> &bound_sums,
+			double threshold);
+	// Adds the leading documents of the champion lists of the query terms
+	// with indexes in [begin, end) to top_documents and stores the indexes of
+	// all of them, matched or not, in champions in ascending order. Returns
+	// true when no other document can get into the result. Does nothing for
+	// queries of more than MAX_CHAMPION_QUERY_TERMS terms
+	template<typename DocumentPredicate>
+	bool AddChampions(const Query &query, const QueryTermOrder &term_order,
+			const std::vector<double> &inverse_document_freqs,
+			DocumentPredicate document_predicate, int begin, int end,
+			TopDocuments &top_documents, std::vector<int> &champions) const;
+	// Adds the most relevant documents with indexes in [begin, end) to
+	// top_documents, skipping documents that cannot get in (MaxScore)
+	template<typename DocumentPredicate>
+	void FindTopDocumentsInRange(const Query &query,
+			const std::vector<double> &inverse_document_freqs,
+			DocumentPredicate document_predicate, int begin, int end,
+			TopDocuments &top_documents, const SearchStop &stop) const;
+	// Scores documents with indexes in [begin, end) using the accumulator of
+	// the current thread
+	template<typename DocumentPredicate>
+	void FindDocumentsInRange(const Query &query,
+			const std::vector<double> &inverse_document_freqs,
+			DocumentPredicate document_predicate, int begin, int end,
+			std::vector<Document> &matched_documents,
+			const SearchStop &stop) const;
+};
+
+class SearchServer::QueryScratch {
+private:
+	friend class SearchServer;
+
+	Query query_;
+	std::vector<double> inverse_document_freqs_;
+	std::vector<Document> matched_documents_;
+	TopDocuments top_documents_ { 0 };
+	std::vector<Document> result_;
 };
 
 template<typename StringContainer>
@@ -139,124 +472,459 @@ SearchServer::SearchServer(const StringContainer &stop_words) :
 	}
 }
 
-template<typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query &query,
-		DocumentPredicate document_predicate) const {
-	return FindAllDocuments(std::execution::seq, query, document_predicate);
+template<typename ExecutionPolicy>
+void SearchServer::AddDocuments(const ExecutionPolicy &policy,
+		const std::vector<NewDocument> &documents) {
+	std::set<int> new_ids;
+	for (const NewDocument &document : documents) {
+		CheckNewDocumentId(document.id);
+		if (!new_ids.insert(document.id).second) {
+			throw invalid_argument("Invalid document_id"s);
+		}
+	}
+	std::vector<ParsedDocument> parsed_documents(documents.size());
+	std::transform(policy, documents.begin(), documents.end(),
+			parsed_documents.begin(), [this](const NewDocument &document) {
+				return ParseDocument(document.text);
+			});
+	for (const ParsedDocument &parsed_document : parsed_documents) {
+		if (!parsed_document.is_valid) {
+			throw invalid_argument("Word "s
+					+ std::string(parsed_document.invalid_word) + " is invalid"s);
+		}
+	}
+	documents_.reserve(documents_.size() + documents.size());
+	for (size_t i = 0; i < documents.size(); ++i) {
+		IndexDocument(documents[i].id, documents[i].text, documents[i].status,
+				documents[i].ratings, parsed_documents[i]);
+	}
 }
 
 template<typename DocumentPredicate>
 std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy &policy, const Query &query,
-		DocumentPredicate document_predicate) const {
-	std::map<int, double> document_to_relevance;
-	for (std::string_view word : query.plus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
-		}
-		const double inverse_document_freq = ComputeWordInverseDocumentFreq(
-				word);
-		for (const auto [document_id, term_freq] : word_to_document_freqs_.at(
-				std::string(word))) {
-			const auto &document_data = documents_.at(document_id);
-			if (document_predicate(document_id, document_data.status,
-					document_data.rating)) {
-				document_to_relevance[document_id] += term_freq
-						* inverse_document_freq;
+		const std::vector<double> &inverse_document_freqs,
+		DocumentPredicate document_predicate, const SearchStop &stop) const {
+	std::vector<Document> matched_documents;
+	FindDocumentsInRange(query, inverse_document_freqs, document_predicate, 0,
+			documents_.size(), matched_documents, stop);
+	return matched_documents;
+}
+
+template<typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(
+		const std::execution::parallel_policy &policy, const Query &query,
+		const std::vector<double> &inverse_document_freqs,
+		DocumentPredicate document_predicate, const SearchStop &stop) const {
+	const int document_count = documents_.size();
+	const int part_count = std::max<int>(1,
+			std::min<int>(parallel_worker_count_, document_count));
+	const int part_size = (document_count + part_count - 1) / part_count;
+	std::vector<std::vector<Document>> part_documents(part_count);
+	std::vector<int> parts(part_count);
+	std::iota(parts.begin(), parts.end(), 0);
+	for_each(policy, parts.begin(), parts.end(), [&](int part) {
+		const int begin = std::min(document_count, part * part_size);
+		const int end = std::min(document_count, begin + part_size);
+		FindDocumentsInRange(query, inverse_document_freqs,
+				document_predicate, begin, end, part_documents[part], stop);
+	});
+	std::vector<Document> matched_documents;
+	for (auto &documents : part_documents) {
+		matched_documents.insert(matched_documents.end(), documents.begin(),
+				documents.end());
+	}
+	return matched_documents;
+}
+
+template<typename DocumentPredicate>
+void SearchServer::FindDocumentsInRange(const Query &query,
+		const std::vector<double> &inverse_document_freqs,
+		DocumentPredicate document_predicate, int begin, int end,
+		std::vector<Document> &matched_documents,
+		const SearchStop &stop) const {
+	ScoreAccumulator &accumulator = ScoreAccumulator::ForCurrentThread();
+	accumulator.Reset(begin, end - begin);
+	// Postings are scanned in chunks of documents with the stop condition
+	// checked before each one, so a stopped search does not wait for the
+	// whole posting list of a common term. Returns false once stopped
+	const auto scan = [begin, end, &stop](const Postings &postings,
+			auto func) {
+		for (int chunk_begin = begin; chunk_begin < end;) {
+			if (stop.ShouldStop()) {
+				return false;
 			}
+			const int chunk_end = end - chunk_begin > STOP_CHECK_INTERVAL ?
+					chunk_begin + STOP_CHECK_INTERVAL : end;
+			postings.ForEachInRange(chunk_begin, chunk_end, func);
+			chunk_begin = chunk_end;
+		}
+		return true;
+	};
+	// Documents with minus words are excluded first, so they are never
+	// checked by the predicate or scored
+	for (TermId term_id : query.minus_terms) {
+		if (!scan(postings_[term_id].postings,
+				[&accumulator](int document_index, int) {
+					accumulator.Exclude(document_index);
+				})) {
+			accumulator.Clear();
+			return;
 		}
 	}
-	for (std::string_view word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
+	for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+		const Postings &postings = postings_[query.plus_terms[i]].postings;
+		if (postings.empty()) {
 			continue;
 		}
-		for (const auto [document_id, _] : word_to_document_freqs_.at(
-				std::string(word))) {
-			document_to_relevance.erase(document_id);
+		const double inverse_document_freq = inverse_document_freqs[i];
+		const bool is_scanned = scan(postings,
+				[&](int document_index, int term_count) {
+					if (accumulator.IsExcluded(document_index)) {
+						return;
+					}
+					const auto &document_data = documents_[document_index];
+					if (document_predicate(document_data.id,
+							document_data.status, document_data.rating)) {
+						accumulator.Add(document_index,
+								term_count * document_data.inv_word_count
+										* inverse_document_freq);
+					}
+				});
+		if (!is_scanned) {
+			accumulator.Clear();
+			return;
 		}
 	}
-	std::vector<Document> matched_documents;
-	for (const auto [document_id, relevance] : document_to_relevance) {
-		matched_documents.push_back(
-				{ document_id, relevance, documents_.at(document_id).rating });
-	}
-	return matched_documents;
+	accumulator.ForEachMatched([&](int document_index, double relevance) {
+		const auto &document_data = documents_[document_index];
+		matched_documents.push_back( { document_data.id, relevance,
+				document_data.rating });
+	});
+	accumulator.Clear();
 }
 
 template<typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(
+std::vector<Document> SearchServer::FindTopDocumentsPruned(
+		const std::execution::sequenced_policy&, const Query &query,
+		const std::vector<double> &inverse_document_freqs,
+		DocumentPredicate document_predicate, size_t max_result_count,
+		const SearchStop &stop) const {
+	TopDocuments top_documents(max_result_count);
+	FindTopDocumentsInRange(query, inverse_document_freqs, document_predicate,
+			0, documents_.size(), top_documents, stop);
+	return top_documents.Extract();
+}
+
+template<typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsPruned(
 		const std::execution::parallel_policy &policy, const Query &query,
-		DocumentPredicate document_predicate) const {
-	ConcurrentMap<int, double> document_to_relevance(CONCURRENT_MAP_DIVISION);
-	for_each(policy, query.plus_words.begin(), query.plus_words.end(),
-			[&](std::string_view word) {
-				if (word_to_document_freqs_.count(word) != 0) {
-					const double inverse_document_freq =
-							ComputeWordInverseDocumentFreq(word);
-					for (const auto [document_id, term_freq] : word_to_document_freqs_.at(
-							std::string(word))) {
-						const auto &document_data = documents_.at(document_id);
-						if (document_predicate(document_id,
-								document_data.status, document_data.rating)) {
-							document_to_relevance[document_id].ref_to_value +=
-									term_freq * inverse_document_freq;
+		const std::vector<double> &inverse_document_freqs,
+		DocumentPredicate document_predicate, size_t max_result_count,
+		const SearchStop &stop) const {
+	const int document_count = documents_.size();
+	const int part_count = std::max<int>(1,
+			std::min<int>(parallel_worker_count_, document_count));
+	const int part_size = (document_count + part_count - 1) / part_count;
+	std::vector<TopDocuments> part_top_documents(part_count,
+			TopDocuments(max_result_count));
+	std::vector<int> parts(part_count);
+	std::iota(parts.begin(), parts.end(), 0);
+	for_each(policy, parts.begin(), parts.end(), [&](int part) {
+		const int begin = std::min(document_count, part * part_size);
+		const int end = std::min(document_count, begin + part_size);
+		FindTopDocumentsInRange(query, inverse_document_freqs,
+				document_predicate, begin, end, part_top_documents[part], stop);
+	});
+	for (int part = 1; part < part_count; ++part) {
+		part_top_documents[0].Merge(part_top_documents[part]);
+	}
+	return part_top_documents[0].Extract();
+}
+
+template<typename DocumentPredicate>
+void SearchServer::FindTopDocumentsInRange(const Query &query,
+		const std::vector<double> &inverse_document_freqs,
+		DocumentPredicate document_predicate, int begin, int end,
+		TopDocuments &top_documents, const SearchStop &stop) const {
+	if (top_documents.IsFull()) {
+		return;
+	}
+	struct TermCursor {
+		// Position of the term in query.plus_terms
+		size_t term;
+		double max_score;
+		Postings::Cursor cursor;
+	};
+	// Terms go in ascending order of their largest possible contribution.
+	// Once the relevance needed to enter the result exceeds the sum of the
+	// bounds of terms [0, first_essential), a document containing only those
+	// terms cannot get in, so candidates come from the remaining essential
+	// terms alone. Those are scored a window of documents at a time
+	thread_local std::vector<TermCursor> terms;
+	thread_local std::vector<double> bound_sums;
+	thread_local std::vector<double> window_scores(MAX_SCORE_WINDOW_SIZE);
+	thread_local std::vector<uint64_t> window_matches(
+			MAX_SCORE_WINDOW_SIZE / 64);
+	// Bits are cleared as a window is read, which an exception thrown by the
+	// predicate may interrupt
+	std::fill(window_matches.begin(), window_matches.end(), 0);
+	terms.clear();
+	for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+		const PostingList &posting_list = postings_[query.plus_terms[i]];
+		if (!posting_list.postings.empty()) {
+			terms.push_back( { i, posting_list.champions.GetMaxTermFreq()
+					* inverse_document_freqs[i], Postings::Cursor(
+					posting_list.postings) });
+			terms.back().cursor.Advance(begin);
+		}
+	}
+	std::sort(terms.begin(), terms.end(),
+			[](const TermCursor &lhs, const TermCursor &rhs) {
+				return lhs.max_score < rhs.max_score;
+			});
+	bound_sums.clear();
+	for (const TermCursor &term : terms) {
+		bound_sums.push_back(
+				(bound_sums.empty() ? 0.0 : bound_sums.back()) + term.max_score);
+	}
+	const QueryTermOrder term_order = SortQueryTerms(query);
+	thread_local std::vector<int> champions;
+	if (AddChampions(query, term_order, inverse_document_freqs,
+			document_predicate, begin, end, top_documents, champions)) {
+		return;
+	}
+	// A document is skipped only when its bound is below the relevance of
+	// every kept document by more than the tolerance, which covers rounding
+	// of the bound sums
+	double threshold = -std::numeric_limits<double>::infinity();
+	size_t first_essential = 0;
+	if (top_documents.IsFull()) {
+		threshold = top_documents.GetMinRelevance() - COMPRASION_TOLERANCE;
+		first_essential = CountNonEssentialTerms(bound_sums, threshold);
+	}
+	// Champions are already in top_documents, so the scan skips them
+	auto champion_it = champions.begin();
+	for (int window_begin = begin; window_begin < end && first_essential
+			< terms.size(); window_begin += MAX_SCORE_WINDOW_SIZE) {
+		if (stop.ShouldStop()) {
+			return;
+		}
+		const int window_end = std::min<int>(end,
+				window_begin + MAX_SCORE_WINDOW_SIZE);
+		for (size_t k = first_essential; k < terms.size(); ++k) {
+			const double inverse_document_freq =
+					inverse_document_freqs[terms[k].term];
+			terms[k].cursor.ForEachBefore(window_end,
+					[&](int document_index, int term_count) {
+						const size_t slot = document_index - window_begin;
+						const uint64_t bit = uint64_t { 1 } << (slot % 64);
+						if ((window_matches[slot / 64] & bit) == 0) {
+							window_matches[slot / 64] |= bit;
+							window_scores[slot] = 0.0;
 						}
+						window_scores[slot] += term_count
+								* documents_[document_index].inv_word_count
+								* inverse_document_freq;
+					});
+		}
+		const size_t non_essential_count = first_essential;
+		for (size_t word = 0; word < window_matches.size(); ++word) {
+			for (uint64_t bits = window_matches[word]; bits != 0;
+					bits &= bits - 1) {
+				const size_t slot = word * 64 + __builtin_ctzll(bits);
+				const int document_index = window_begin + slot;
+				while (champion_it != champions.end()
+						&& *champion_it < document_index) {
+					++champion_it;
+				}
+				if (champion_it != champions.end()
+						&& *champion_it == document_index) {
+					continue;
+				}
+				const DocumentData &document_data = documents_[document_index];
+				double bound = window_scores[slot]
+						+ (non_essential_count == 0 ?
+								0.0 : bound_sums[non_essential_count - 1]);
+				for (size_t k = non_essential_count; k-- > 0 && bound >= threshold;) {
+					bound -= terms[k].max_score;
+					Postings::Cursor &cursor = terms[k].cursor;
+					cursor.Advance(document_index);
+					if (!cursor.IsDone()
+							&& cursor.GetDocumentIndex() == document_index) {
+						bound += cursor.GetTermCount()
+								* document_data.inv_word_count
+								* inverse_document_freqs[terms[k].term];
 					}
 				}
+				if (bound < threshold) {
+					continue;
+				}
+				const Document document { document_data.id,
+						ComputeRelevance(term_order, inverse_document_freqs,
+								document_index), document_data.rating };
+				if (top_documents.IsFull()
+						&& !IsMoreRelevant(document, top_documents.GetWorst())) {
+					continue;
+				}
+				if (HasMinusTerm(query, document_index)
+						|| !document_predicate(document_data.id,
+								document_data.status, document_data.rating)) {
+					continue;
+				}
+				top_documents.Add(document);
+				if (top_documents.IsFull()) {
+					threshold = top_documents.GetMinRelevance()
+							- COMPRASION_TOLERANCE;
+					first_essential = CountNonEssentialTerms(bound_sums,
+							threshold);
+				}
 			}
-	);
-	for_each(policy, query.minus_words.begin(), query.minus_words.end(),
-			[&](std::string_view word) {
-				if (word_to_document_freqs_.count(word) != 0) {
-					for (const auto [document_id, _] : word_to_document_freqs_.at(
-							std::string(word))) {
-						document_to_relevance.erase(document_id);
-					}
+			window_matches[word] = 0;
+		}
+	}
+}
+
+template<typename DocumentPredicate>
+bool SearchServer::AddChampions(const Query &query,
+		const QueryTermOrder &term_order,
+		const std::vector<double> &inverse_document_freqs,
+		DocumentPredicate document_predicate, int begin, int end,
+		TopDocuments &top_documents, std::vector<int> &champions) const {
+	champions.clear();
+	if (query.plus_terms.size() > MAX_CHAMPION_QUERY_TERMS) {
+		return false;
+	}
+	// Every term gives an equal share of about CAPACITY documents, so a
+	// single-term query takes its whole list
+	const size_t share = (ChampionList::CAPACITY + query.plus_terms.size() - 1)
+			/ std::max<size_t>(1, query.plus_terms.size());
+	// A document not taken has every term frequency within the bound of the
+	// champions left of the term and the postings outside the list, so its
+	// relevance is within outside_relevance. Both sums go in query order,
+	// which keeps the bound exact in floating point
+	double outside_relevance = 0.0;
+	for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+		const ChampionList &champion_list =
+				postings_[query.plus_terms[i]].champions;
+		const auto &term_champions = champion_list.GetChampions();
+		const size_t count = std::min(share, term_champions.size());
+		for (size_t k = 0; k < count; ++k) {
+			if (term_champions[k].document_index >= begin
+					&& term_champions[k].document_index < end) {
+				champions.push_back(term_champions[k].document_index);
+			}
+		}
+		outside_relevance += champion_list.GetBoundAfter(count)
+				* inverse_document_freqs[i];
+	}
+	std::sort(champions.begin(), champions.end());
+	champions.erase(std::unique(champions.begin(), champions.end()),
+			champions.end());
+	for (int document_index : champions) {
+		const DocumentData &document_data = documents_[document_index];
+		if (HasMinusTerm(query, document_index)
+				|| !document_predicate(document_data.id, document_data.status,
+						document_data.rating)) {
+			continue;
+		}
+		top_documents.Add( { document_data.id, ComputeRelevance(term_order,
+				inverse_document_freqs, document_index), document_data.rating });
+	}
+	return top_documents.IsFull()
+			&& top_documents.GetMinRelevance() - outside_relevance
+					>= COMPRASION_TOLERANCE;
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::PrecomputeInverseDocumentFreqs(
+		const ExecutionPolicy &policy) const {
+	for_each(policy, postings_.begin(), postings_.end(),
+			[this](const PostingList &posting_list) {
+				if (!posting_list.postings.empty()) {
+					ComputeWordInverseDocumentFreq(posting_list);
 				}
 			});
-	std::vector<Document> matched_documents;
-	for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-		matched_documents.push_back(
-				{ document_id, relevance, documents_.at(document_id).rating });
-	}
-	return matched_documents;
 }
 
 template<typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
-		DocumentPredicate document_predicate) const {
-	return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+		DocumentPredicate document_predicate, size_t max_result_count) const {
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate,
+			max_result_count);
 }
 
 template<typename DocumentPredicate, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(
 		const ExecutionPolicy &policy,
 		std::string_view raw_query,
-		DocumentPredicate document_predicate) const {
-	const auto query = ParseQuery(raw_query, true);
-	auto matched_documents = FindAllDocuments(policy, query,
-			document_predicate);
-	sort(policy, matched_documents.begin(), matched_documents.end(),
-			[](const Document &lhs, const Document &rhs) {
-				if (abs(lhs.relevance - rhs.relevance) < COMPRASION_TOLERANCE) {
-					return lhs.rating > rhs.rating;
-				} else {
-					return lhs.relevance > rhs.relevance;
-				}
-			});
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-	}
-	return matched_documents;
+		DocumentPredicate document_predicate, size_t max_result_count) const {
+	return FindTopDocumentsForQuery(policy, ParseQuery(raw_query, true),
+			document_predicate, max_result_count, SearchStop());
 }
 
 template<typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy &policy,
-		std::string_view raw_query, DocumentStatus status) const {
-	return FindTopDocuments(policy, raw_query,
-			[status](int document_id, DocumentStatus document_status,
-					int rating) {
-				return document_status == status;
-			});
+		std::string_view raw_query, DocumentStatus status,
+		size_t max_result_count) const {
+	return *TryFindTopDocuments(policy, raw_query, status, SearchStop(),
+			max_result_count);
+}
+
+template<typename ExecutionPolicy>
+std::optional<std::vector<Document>> SearchServer::TryFindTopDocuments(
+		const ExecutionPolicy &policy, std::string_view raw_query,
+		DocumentStatus status, const SearchStop &stop,
+		size_t max_result_count) const {
+	const auto query = ParseQuery(raw_query, true);
+	const auto status_predicate = [status](int document_id,
+			DocumentStatus document_status, int rating) {
+		return document_status == status;
+	};
+	if (query_cache_ == nullptr) {
+		auto documents = FindTopDocumentsForQuery(policy, query,
+				status_predicate, max_result_count, stop);
+		if (stop.IsStopped()) {
+			return std::nullopt;
+		}
+		return documents;
+	}
+	const std::string key = MakeQueryCacheKey(query, status, max_result_count);
+	if (auto cached_documents = query_cache_->Find(key, index_epoch_)) {
+		return std::move(*cached_documents);
+	}
+	auto documents = FindTopDocumentsForQuery(policy, query, status_predicate,
+			max_result_count, stop);
+	if (stop.IsStopped()) {
+		return std::nullopt;
+	}
+	query_cache_->Insert(key, index_epoch_, documents);
+	return documents;
+}
+
+template<typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsForQuery(
+		const ExecutionPolicy &policy, const Query &query,
+		DocumentPredicate document_predicate, size_t max_result_count,
+		const SearchStop &stop) const {
+	return FindTopDocumentsForQuery(policy, query,
+			ComputeInverseDocumentFreqs(query), document_predicate,
+			max_result_count, stop);
+}
+
+template<typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsForQuery(
+		const ExecutionPolicy &policy, const Query &query,
+		const std::vector<double> &inverse_document_freqs,
+		DocumentPredicate document_predicate, size_t max_result_count,
+		const SearchStop &stop) const {
+	if (dynamic_pruning_) {
+		return FindTopDocumentsPruned(policy, query, inverse_document_freqs,
+				document_predicate, max_result_count, stop);
+	}
+	return SelectTopDocuments(policy,
+			FindAllDocuments(policy, query, inverse_document_freqs,
+					document_predicate, stop), max_result_count,
+			parallel_worker_count_);
 }
 
 template<typename ExecutionPolicy>
@@ -265,68 +933,131 @@ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy &poli
 	return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
+template<typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(
+		const ExecutionPolicy &policy, std::string_view raw_query,
+		DocumentPredicate document_predicate,
+		const CorpusStatistics &statistics, size_t max_result_count) const {
+	auto query = ParseQuery(raw_query, true);
+	// Pairs of the corpus term id and the own term id
+	std::vector<std::pair<TermId, TermId>> plus_terms;
+	plus_terms.reserve(query.plus_terms.size());
+	for (TermId term_id : query.plus_terms) {
+		plus_terms.emplace_back(
+				statistics.FindTermId(dictionary_.GetTerm(term_id)), term_id);
+	}
+	std::sort(plus_terms.begin(), plus_terms.end());
+	std::vector<double> inverse_document_freqs;
+	inverse_document_freqs.reserve(plus_terms.size());
+	for (size_t i = 0; i < plus_terms.size(); ++i) {
+		query.plus_terms[i] = plus_terms[i].second;
+		inverse_document_freqs.push_back(statistics.ComputeInverseDocumentFreq(
+				dictionary_.GetTerm(plus_terms[i].second)));
+	}
+	return FindTopDocumentsForQuery(policy, query, inverse_document_freqs,
+			document_predicate, max_result_count, SearchStop());
+}
+
 template<typename ExecutionPolicy>
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
-		const ExecutionPolicy &policy,
+		const ExecutionPolicy&,
 		std::string_view raw_query, int document_id) const {
-	if constexpr (is_same_v<decay_t<ExecutionPolicy>,
-			execution::sequenced_policy>) {
-		return MatchDocument(raw_query, document_id);
-	}
+	// Matching merges two short sorted arrays, which is not worth splitting
+	// between threads
+	return MatchDocument(raw_query, document_id);
+}
+
+template<typename ExecutionPolicy>
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(
+		const ExecutionPolicy &policy, std::string_view raw_query,
+		const std::vector<int> &document_ids) const {
 	if (raw_query.empty()) {
 		throw std::invalid_argument("");
 	}
-	if (document_ids_.count(document_id) == 0) {
-		throw std::out_of_range("");
-	}
-	const auto query = ParseQuery(raw_query);
-	if (std::any_of(query.minus_words.begin(), query.minus_words.end(),
-			[&](string_view word) {
-				return word_to_document_freqs_.at(std::string(word)).count(document_id);
-			})) {
-		return {std::vector<std::string_view> {},
-			documents_.at(document_id).status};
-	}
-	std::vector<std::string> matched_words(query.plus_words.size());
-	auto it = std::copy_if(query.plus_words.begin(),
-			query.plus_words.end(), matched_words.begin(),
-			[&](string_view word) {
-				return word_to_document_freqs_.at(std::string(word)).count(document_id);
-			}
-	);
-	matched_words.erase(it, matched_words.end());
-	std::sort(matched_words.begin(), matched_words.end());
-	auto last = std::unique(matched_words.begin(), matched_words.end());
-	matched_words.erase(last, matched_words.end());
-	std::vector<std::string_view> matched_words_res(matched_words.size());
-	std::transform(matched_words.begin(), matched_words.end(), matched_words_res.begin(), [&](const string &str) {
-		return std::string_view((*word_to_document_freqs_.find(str)).first);
-	});
-	return {matched_words_res, documents_.at(document_id).status};
+	// Ids are checked up front, as an exception escaping a parallel algorithm
+	// terminates the program
+	std::vector<int> document_indexes(document_ids.size());
+	std::transform(document_ids.begin(), document_ids.end(),
+			document_indexes.begin(), [this](int document_id) {
+				return GetDocumentIndex(document_id);
+			});
+	const auto query = ParseQuery(raw_query, true);
+	std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> matches(
+			document_ids.size());
+	std::transform(policy, document_indexes.begin(), document_indexes.end(),
+			matches.begin(), [&](int document_index) {
+				return std::make_tuple(MatchDocumentTerms(query, document_index),
+						documents_[document_index].status);
+			});
+	return matches;
 }
 
 template<typename ExecutionPolicy>
 void SearchServer::RemoveDocument(const ExecutionPolicy &policy,
 		int document_id) {
-	if constexpr (is_same_v<decay_t<ExecutionPolicy>,
-			execution::sequenced_policy>) {
-		RemoveDocument(document_id);
+	RemoveDocuments(policy, std::vector<int> { document_id });
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::RemoveDocuments(const ExecutionPolicy &policy,
+		const std::vector<int> &document_ids) {
+	std::vector<RemovedPosting> removed_postings;
+	std::vector<int> removed_ids;
+	for (int document_id : document_ids) {
+		const auto index_it = document_id_to_index_.find(document_id);
+		if (index_it == document_id_to_index_.end()) {
+			continue;
+		}
+		const int document_index = index_it->second;
+		const DocumentData &document_data = documents_[document_index];
+		for (size_t i = document_data.terms_begin; i < document_data.terms_end;
+				++i) {
+			removed_postings.push_back( { document_terms_[i], document_index });
+		}
+		document_text_bytes_ -= document_data.text.size();
+		document_id_to_index_.erase(index_it);
+		removed_ids.push_back(document_id);
+	}
+	if (removed_ids.empty()) {
 		return;
 	}
-	const std::map<std::string_view, double> &words_to_del = GetWordFrequencies(
-			document_id);
-	std::vector<const std::string_view*> p_words_to_del(words_to_del.size());
-	std::transform(words_to_del.begin(), words_to_del.end(),
-			p_words_to_del.begin(),
-			[](const auto &word) {
-				return &word.first;
+	std::sort(policy, removed_postings.begin(), removed_postings.end());
+	removed_postings.erase(
+			std::unique(removed_postings.begin(), removed_postings.end()),
+			removed_postings.end());
+	std::vector<int> removed_indexes(removed_postings.size());
+	std::transform(removed_postings.begin(), removed_postings.end(),
+			removed_indexes.begin(), [](const RemovedPosting &posting) {
+				return posting.second;
 			});
-	for_each(p_words_to_del.begin(), p_words_to_del.end(),
-			[&](const std::string_view *word) {
-				word_to_document_freqs_.at(std::string(*word)).erase(document_id);
-			});
-	documents_.erase(document_id);
-	document_ids_.erase(document_id);
-	word_frequencies_.erase(document_id);
+	// Every term owns a separate posting list, so terms are processed in
+	// parallel
+	std::vector<size_t> term_begins;
+	for (size_t i = 0; i < removed_postings.size(); ++i) {
+		if (i == 0
+				|| removed_postings[i].first != removed_postings[i - 1].first) {
+			term_begins.push_back(i);
+		}
+	}
+	std::vector<size_t> terms(term_begins.size());
+	std::iota(terms.begin(), terms.end(), 0);
+	term_begins.push_back(removed_postings.size());
+	std::for_each(policy, terms.begin(), terms.end(), [&](size_t term) {
+		PostingList &posting_list =
+				postings_[removed_postings[term_begins[term]].first];
+		const int *removed_begin = removed_indexes.data() + term_begins[term];
+		const int *removed_end = removed_indexes.data() + term_begins[term + 1];
+		posting_list.postings.Remove(removed_begin, removed_end);
+		posting_list.champions.Remove(removed_begin, removed_end);
+		if (posting_list.champions.IsDepleted()) {
+			RebuildChampionList(posting_list);
+		}
+	});
+	for (int document_id : removed_ids) {
+		document_ids_.erase(document_id);
+	}
+	++index_epoch_;
+	if (2 * document_ids_.size() < documents_.size()) {
+		CompactDocuments();
+	}
 }
-
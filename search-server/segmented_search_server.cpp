@@ -0,0 +1,256 @@
+#include "segmented_search_server.h"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+using namespace std::string_literals;
+
+SegmentedSearchServer::SegmentedSearchServer(
+		const std::string &stop_words_text) :
+		SegmentedSearchServer(std::string_view(stop_words_text)) {
+}
+
+SegmentedSearchServer::SegmentedSearchServer(std::string_view stop_words_text) :
+		SegmentedSearchServer(SplitIntoWords(stop_words_text)) {
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+	{
+		std::lock_guard guard(merger_mutex_);
+		stopping_ = true;
+	}
+	merger_wakeup_.notify_all();
+	merger_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id,
+		std::string_view document, DocumentStatus status,
+		const std::vector<int> &ratings) {
+	std::unique_lock lock(mutex_);
+	if (document_segments_.count(document_id) > 0) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	write_buffer_->AddDocument(document_id, document, status, ratings);
+	statistics_.AddDocument(write_buffer_->GetWordFrequencies(document_id));
+	document_segments_.emplace(document_id, write_buffer_serial_);
+	if (static_cast<size_t>(write_buffer_->GetDocumentCount())
+			>= write_buffer_size_) {
+		FreezeWriteBuffer();
+	}
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+	std::unique_lock lock(mutex_);
+	const auto it = document_segments_.find(document_id);
+	if (it == document_segments_.end()) {
+		return;
+	}
+	const uint64_t serial = it->second;
+	document_segments_.erase(it);
+	if (serial == write_buffer_serial_) {
+		statistics_.RemoveDocument(
+				write_buffer_->GetWordFrequencies(document_id));
+		write_buffer_->RemoveDocument(document_id);
+		return;
+	}
+	Segment &segment = segments_[FindSegment(serial)];
+	statistics_.RemoveDocument(segment.index->GetWordFrequencies(document_id));
+	segment.tombstones.insert(document_id);
+	if (segment.tombstones.size() * 2
+			>= static_cast<size_t>(segment.index->GetDocumentCount())) {
+		RequestMerge();
+	}
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(
+		std::string_view raw_query, DocumentStatus status,
+		size_t max_result_count) const {
+	return FindTopDocuments(std::execution::seq, raw_query, status,
+			max_result_count);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(
+		std::string_view raw_query) const {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SegmentedSearchServer::MatchDocument(
+		std::string_view raw_query, int document_id) const {
+	std::shared_lock lock(mutex_);
+	const auto it = document_segments_.find(document_id);
+	if (it == document_segments_.end()) {
+		throw std::out_of_range("");
+	}
+	auto [words, status] = GetIndex(it->second).MatchDocument(raw_query,
+			document_id);
+	// The words of the segment die with it when it is merged
+	for (std::string_view &word : words) {
+		word = statistics_.FindWord(word);
+	}
+	return {words, status};
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+	std::shared_lock lock(mutex_);
+	return statistics_.GetDocumentCount();
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+	std::shared_lock lock(mutex_);
+	return segments_.size();
+}
+
+void SegmentedSearchServer::Flush() {
+	{
+		std::unique_lock lock(mutex_);
+		FreezeWriteBuffer();
+	}
+	std::unique_lock lock(merger_mutex_);
+	merge_requested_ = true;
+	merger_wakeup_.notify_all();
+	merger_idle_.wait(lock, [this] {
+		return !merge_requested_ && !merger_busy_;
+	});
+}
+
+const SearchServer& SegmentedSearchServer::GetIndex(uint64_t serial) const {
+	if (serial == write_buffer_serial_) {
+		return *write_buffer_;
+	}
+	return *segments_[FindSegment(serial)].index;
+}
+
+size_t SegmentedSearchServer::FindSegment(uint64_t serial) const {
+	return std::find_if(segments_.begin(), segments_.end(),
+			[serial](const Segment &segment) {
+				return segment.serial == serial;
+			}) - segments_.begin();
+}
+
+void SegmentedSearchServer::FreezeWriteBuffer() {
+	if (write_buffer_->GetDocumentCount() == 0) {
+		return;
+	}
+	segments_.push_back( { write_buffer_serial_, 0, std::move(write_buffer_),
+			{ } });
+	write_buffer_ = std::make_unique<SearchServer>(stop_words_);
+	write_buffer_serial_ = next_serial_++;
+	RequestMerge();
+}
+
+void SegmentedSearchServer::RequestMerge() {
+	{
+		std::lock_guard guard(merger_mutex_);
+		merge_requested_ = true;
+	}
+	merger_wakeup_.notify_all();
+}
+
+void SegmentedSearchServer::RunMerger() {
+	std::unique_lock lock(merger_mutex_);
+	while (true) {
+		merger_wakeup_.wait(lock, [this] {
+			return stopping_ || merge_requested_;
+		});
+		if (stopping_) {
+			return;
+		}
+		merge_requested_ = false;
+		merger_busy_ = true;
+		lock.unlock();
+		while (MergeSegments()) {
+		}
+		lock.lock();
+		merger_busy_ = false;
+		merger_idle_.notify_all();
+	}
+}
+
+bool SegmentedSearchServer::MergeSegments() {
+	std::vector<std::shared_ptr<const SearchServer>> inputs;
+	std::vector<uint64_t> input_serials;
+	std::vector<std::unordered_set<int>> input_tombstones;
+	int merged_tier = 0;
+	{
+		std::shared_lock lock(mutex_);
+		for (size_t i : PickSegmentsToMerge(merged_tier)) {
+			inputs.push_back(segments_[i].index);
+			input_serials.push_back(segments_[i].serial);
+			input_tombstones.push_back(segments_[i].tombstones);
+		}
+	}
+	if (inputs.empty()) {
+		return false;
+	}
+
+	// Segments are immutable, so they are read without the lock. Documents
+	// removed meanwhile are dropped below when the result is published
+	std::vector<NewDocument> documents;
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		for (int document_id : *inputs[i]) {
+			if (input_tombstones[i].count(document_id) == 0) {
+				documents.push_back( { document_id,
+						inputs[i]->GetDocumentText(document_id),
+						inputs[i]->GetDocumentStatus(document_id),
+						{ inputs[i]->GetDocumentRating(document_id) } });
+			}
+		}
+	}
+	auto merged_index = std::make_shared<SearchServer>(stop_words_);
+	merged_index->AddDocuments(std::execution::par, documents);
+
+	std::unique_lock lock(mutex_);
+	Segment merged { next_serial_++, merged_tier, std::move(merged_index), { } };
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		const Segment &input = segments_[FindSegment(input_serials[i])];
+		for (int document_id : input.tombstones) {
+			if (input_tombstones[i].count(document_id) == 0) {
+				merged.tombstones.insert(document_id);
+			}
+		}
+	}
+	for (const NewDocument &document : documents) {
+		const auto it = document_segments_.find(document.id);
+		// Skips documents removed during the merge, including the ones
+		// added again since then under the same id
+		if (it != document_segments_.end()
+				&& std::find(input_serials.begin(), input_serials.end(),
+						it->second) != input_serials.end()) {
+			it->second = merged.serial;
+		}
+	}
+	segments_.erase(std::remove_if(segments_.begin(), segments_.end(),
+			[&input_serials](const Segment &segment) {
+				return std::find(input_serials.begin(), input_serials.end(),
+						segment.serial) != input_serials.end();
+			}), segments_.end());
+	if (merged.tombstones.size()
+			< static_cast<size_t>(merged.index->GetDocumentCount())) {
+		segments_.push_back(std::move(merged));
+	}
+	return true;
+}
+
+std::vector<size_t> SegmentedSearchServer::PickSegmentsToMerge(
+		int &merged_tier) const {
+	std::map<int, std::vector<size_t>> tiers;
+	for (size_t i = 0; i < segments_.size(); ++i) {
+		auto &tier = tiers[segments_[i].tier];
+		tier.push_back(i);
+		if (tier.size() == MERGE_FACTOR) {
+			merged_tier = segments_[i].tier + 1;
+			return tier;
+		}
+	}
+	for (size_t i = 0; i < segments_.size(); ++i) {
+		const Segment &segment = segments_[i];
+		if (!segment.tombstones.empty()
+				&& segment.tombstones.size() * 2
+						>= static_cast<size_t>(segment.index->GetDocumentCount())) {
+			merged_tier = segment.tier;
+			return {i};
+		}
+	}
+	return {};
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <execution>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "corpus_statistics.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+// Index split into immutable segments and a small write buffer, in the manner
+// of a log-structured merge tree. New documents go to the buffer, and a full
+// buffer is frozen into a segment. Removing a document from a segment only
+// records a tombstone. A background thread merges segments of the same size
+// tier and rewrites segments that are mostly tombstones, so adding a document
+// costs the same however large the index is. Queries are scored in every
+// segment with IDFs of the whole index and the results are merged.
+class SegmentedSearchServer {
+public:
+	static constexpr size_t DEFAULT_WRITE_BUFFER_SIZE = 4096;
+	// Number of segments of one tier merged into a segment of the next tier
+	static constexpr size_t MERGE_FACTOR = 4;
+
+	template<typename StringContainer>
+	explicit SegmentedSearchServer(const StringContainer &stop_words,
+			size_t write_buffer_size = DEFAULT_WRITE_BUFFER_SIZE);
+
+	explicit SegmentedSearchServer(const std::string &stop_words_text);
+
+	explicit SegmentedSearchServer(std::string_view stop_words_text);
+
+	~SegmentedSearchServer();
+
+	void AddDocument(int document_id, std::string_view document,
+			DocumentStatus status, const std::vector<int> &ratings);
+
+	void RemoveDocument(int document_id);
+
+	template<typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query,
+			DocumentPredicate document_predicate,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query,
+			DocumentStatus status,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	// The policy applies to the fan-out over segments
+	template<typename ExecutionPolicy, typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy &policy,
+			std::string_view raw_query, DocumentPredicate document_predicate,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	template<typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy &policy,
+			std::string_view raw_query, DocumentStatus status,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	// Returned words stay valid for the lifetime of the server
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
+			std::string_view raw_query, int document_id) const;
+
+	int GetDocumentCount() const;
+
+	// Frozen segments, not counting the write buffer
+	size_t GetSegmentCount() const;
+
+	// Freezes the write buffer and waits until the merger runs out of work
+	void Flush();
+
+private:
+	struct Segment {
+		uint64_t serial;
+		int tier;
+		std::shared_ptr<const SearchServer> index;
+		std::unordered_set<int> tombstones;
+	};
+
+	const std::vector<std::string> stop_words_;
+	const size_t write_buffer_size_;
+
+	// Guards everything below up to the merger state
+	mutable std::shared_mutex mutex_;
+	std::vector<Segment> segments_;
+	std::unique_ptr<SearchServer> write_buffer_;
+	uint64_t write_buffer_serial_ = 0;
+	uint64_t next_serial_ = 1;
+	// Serial of the segment or the write buffer holding each live document
+	std::unordered_map<int, uint64_t> document_segments_;
+	CorpusStatistics statistics_;
+
+	std::mutex merger_mutex_;
+	std::condition_variable merger_wakeup_;
+	std::condition_variable merger_idle_;
+	bool merge_requested_ = false;
+	bool merger_busy_ = false;
+	bool stopping_ = false;
+	std::thread merger_;
+
+	const SearchServer& GetIndex(uint64_t serial) const;
+	// Position of the segment in segments_
+	size_t FindSegment(uint64_t serial) const;
+	// Must be called with mutex_ held exclusively
+	void FreezeWriteBuffer();
+	void RequestMerge();
+	void RunMerger();
+	// Returns false if there was nothing to merge
+	bool MergeSegments();
+	// Indexes in segments_ of the segments worth merging next
+	std::vector<size_t> PickSegmentsToMerge(int &merged_tier) const;
+};
+
+template<typename StringContainer>
+SegmentedSearchServer::SegmentedSearchServer(const StringContainer &stop_words,
+		size_t write_buffer_size) :
+		stop_words_(std::begin(stop_words), std::end(stop_words)), write_buffer_size_(
+				std::max<size_t>(1, write_buffer_size)), write_buffer_(
+				std::make_unique<SearchServer>(stop_words_)) {
+	merger_ = std::thread(&SegmentedSearchServer::RunMerger, this);
+}
+
+template<typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(
+		std::string_view raw_query, DocumentPredicate document_predicate,
+		size_t max_result_count) const {
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate,
+			max_result_count);
+}
+
+template<typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(
+		const ExecutionPolicy &policy, std::string_view raw_query,
+		DocumentPredicate document_predicate, size_t max_result_count) const {
+	std::shared_lock lock(mutex_);
+	// The last part is the write buffer
+	std::vector<std::vector<Document>> part_documents(segments_.size() + 1);
+	std::vector<size_t> parts(part_documents.size());
+	std::iota(parts.begin(), parts.end(), 0);
+	std::for_each(policy, parts.begin(), parts.end(), [&](size_t part) {
+		if (part == segments_.size()) {
+			part_documents[part] = write_buffer_->FindTopDocuments(
+					std::execution::seq, raw_query, document_predicate,
+					statistics_, max_result_count);
+			return;
+		}
+		const Segment &segment = segments_[part];
+		part_documents[part] = segment.index->FindTopDocuments(
+				std::execution::seq, raw_query,
+				[&](int document_id, DocumentStatus status, int rating) {
+					return segment.tombstones.count(document_id) == 0
+							&& document_predicate(document_id, status, rating);
+				}, statistics_, max_result_count);
+	});
+	TopDocuments top_documents(max_result_count);
+	for (const auto &documents : part_documents) {
+		for (const Document &document : documents) {
+			top_documents.Add(document);
+		}
+	}
+	return top_documents.Extract();
+}
+
+template<typename ExecutionPolicy>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(
+		const ExecutionPolicy &policy, std::string_view raw_query,
+		DocumentStatus status, size_t max_result_count) const {
+	return FindTopDocuments(policy, raw_query,
+			[status](int document_id, DocumentStatus document_status,
+					int rating) {
+				return document_status == status;
+			}, max_result_count);
+}
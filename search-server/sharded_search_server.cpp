@@ -0,0 +1,142 @@
+#include "sharded_search_server.h"
+#include <stdexcept>
+#include <utility>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std::string_literals;
+
+ShardedSearchServer::ShardWorker::ShardWorker(size_t cpu) :
+		thread_(&ShardWorker::Run, this) {
+#ifdef __linux__
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu % std::max(1u, std::thread::hardware_concurrency()), &cpu_set);
+	// Pinning is only a hint for the scheduler, so a failure is ignored
+	pthread_setaffinity_np(thread_.native_handle(), sizeof(cpu_set), &cpu_set);
+#endif
+}
+
+ShardedSearchServer::ShardWorker::~ShardWorker() {
+	{
+		std::lock_guard guard(mutex_);
+		stopping_ = true;
+	}
+	wakeup_.notify_one();
+	thread_.join();
+}
+
+void ShardedSearchServer::ShardWorker::Run() {
+	std::unique_lock lock(mutex_);
+	while (true) {
+		wakeup_.wait(lock, [this] {
+			return stopping_ || !tasks_.empty();
+		});
+		if (tasks_.empty()) {
+			return;
+		}
+		auto task = std::move(tasks_.front());
+		tasks_.pop_front();
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+ShardedSearchServer::Shard::Shard(const std::vector<std::string> &stop_words,
+		size_t cpu) :
+		index(stop_words), worker(cpu) {
+}
+
+ShardedSearchServer::ShardedSearchServer(const std::string &stop_words_text,
+		size_t shard_count) :
+		ShardedSearchServer(std::string_view(stop_words_text), shard_count) {
+}
+
+ShardedSearchServer::ShardedSearchServer(std::string_view stop_words_text,
+		size_t shard_count) :
+		ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count) {
+}
+
+void ShardedSearchServer::AddDocument(int document_id,
+		std::string_view document, DocumentStatus status,
+		const std::vector<int> &ratings) {
+	std::unique_lock lock(mutex_);
+	if (document_ids_.count(document_id) > 0) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	Shard &shard = GetShard(document_id);
+	shard.worker.Submit([&] {
+		shard.index.AddDocument(document_id, document, status, ratings);
+		statistics_.AddDocument(shard.index.GetWordFrequencies(document_id));
+	}).get();
+	document_ids_.insert(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+	std::unique_lock lock(mutex_);
+	if (document_ids_.erase(document_id) == 0) {
+		return;
+	}
+	Shard &shard = GetShard(document_id);
+	shard.worker.Submit([&] {
+		statistics_.RemoveDocument(shard.index.GetWordFrequencies(document_id));
+		shard.index.RemoveDocument(document_id);
+	}).get();
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+		std::string_view raw_query, DocumentStatus status,
+		size_t max_result_count) const {
+	return FindTopDocuments(raw_query,
+			[status](int document_id, DocumentStatus document_status,
+					int rating) {
+				return document_status == status;
+			}, max_result_count);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+		std::string_view raw_query) const {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(
+		std::string_view raw_query, int document_id) const {
+	std::shared_lock lock(mutex_);
+	if (document_ids_.count(document_id) == 0) {
+		throw std::out_of_range("");
+	}
+	Shard &shard = GetShard(document_id);
+	return shard.worker.Submit([&] {
+		return shard.index.MatchDocument(raw_query, document_id);
+	}).get();
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+	std::shared_lock lock(mutex_);
+	return statistics_.GetDocumentCount();
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+	return shards_.size();
+}
+
+size_t ShardedSearchServer::GetDefaultShardCount() {
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ShardedSearchServer::CreateShards(
+		const std::vector<std::string> &stop_words, size_t shard_count) {
+	shard_count = std::max<size_t>(1, shard_count);
+	shards_.reserve(shard_count);
+	for (size_t i = 0; i < shard_count; ++i) {
+		shards_.push_back(std::make_unique<Shard>(stop_words, i));
+	}
+}
+
+ShardedSearchServer::Shard& ShardedSearchServer::GetShard(
+		int document_id) const {
+	return *shards_[std::hash<int> { }(document_id) % shards_.size()];
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+#include "corpus_statistics.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+// Documents partitioned by id hash over several SearchServer shards. Every
+// shard is touched only by its own worker thread, pinned to a core where the
+// platform allows it. Queries are scattered to all shards, scored there with
+// document frequencies of the whole corpus, and the per-shard top documents
+// are merged, so results are the ones of a single server holding all
+// documents.
+class ShardedSearchServer {
+public:
+	template<typename StringContainer>
+	explicit ShardedSearchServer(const StringContainer &stop_words,
+			size_t shard_count = GetDefaultShardCount());
+
+	explicit ShardedSearchServer(const std::string &stop_words_text,
+			size_t shard_count = GetDefaultShardCount());
+
+	explicit ShardedSearchServer(std::string_view stop_words_text,
+			size_t shard_count = GetDefaultShardCount());
+
+	void AddDocument(int document_id, std::string_view document,
+			DocumentStatus status, const std::vector<int> &ratings);
+
+	void RemoveDocument(int document_id);
+
+	// The predicate is called from the shard workers concurrently
+	template<typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query,
+			DocumentPredicate document_predicate,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query,
+			DocumentStatus status,
+			size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
+			std::string_view raw_query, int document_id) const;
+
+	int GetDocumentCount() const;
+
+	size_t GetShardCount() const;
+
+	// One shard per hardware thread
+	static size_t GetDefaultShardCount();
+
+private:
+	// Runs tasks one by one on a dedicated thread
+	class ShardWorker {
+	public:
+		explicit ShardWorker(size_t cpu);
+		~ShardWorker();
+
+		template<typename Task>
+		auto Submit(Task task) -> std::future<decltype(task())>;
+
+	private:
+		std::mutex mutex_;
+		std::condition_variable wakeup_;
+		std::deque<std::function<void()>> tasks_;
+		bool stopping_ = false;
+		std::thread thread_;
+
+		void Run();
+	};
+
+	struct Shard {
+		explicit Shard(const std::vector<std::string> &stop_words, size_t cpu);
+
+		SearchServer index;
+		ShardWorker worker;
+	};
+
+	// Writers take it exclusively, so a query sees the statistics and the
+	// shards in the same state
+	mutable std::shared_mutex mutex_;
+	std::vector<std::unique_ptr<Shard>> shards_;
+	std::unordered_set<int> document_ids_;
+	CorpusStatistics statistics_;
+
+	void CreateShards(const std::vector<std::string> &stop_words,
+			size_t shard_count);
+
+	Shard& GetShard(int document_id) const;
+};
+
+template<typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(const StringContainer &stop_words,
+		size_t shard_count) {
+	CreateShards(
+			std::vector<std::string>(std::begin(stop_words),
+					std::end(stop_words)), shard_count);
+}
+
+template<typename Task>
+auto ShardedSearchServer::ShardWorker::Submit(Task task) -> std::future<
+		decltype(task())> {
+	auto packaged_task = std::make_shared<
+			std::packaged_task<decltype(task())()>>(std::move(task));
+	auto result = packaged_task->get_future();
+	{
+		std::lock_guard guard(mutex_);
+		tasks_.emplace_back([packaged_task] {
+			(*packaged_task)();
+		});
+	}
+	wakeup_.notify_one();
+	return result;
+}
+
+template<typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+		std::string_view raw_query, DocumentPredicate document_predicate,
+		size_t max_result_count) const {
+	std::shared_lock lock(mutex_);
+	std::vector<std::future<std::vector<Document>>> shard_documents;
+	shard_documents.reserve(shards_.size());
+	for (const auto &shard : shards_) {
+		const SearchServer &index = shard->index;
+		shard_documents.push_back(shard->worker.Submit([this, &index,
+				raw_query, &document_predicate, max_result_count] {
+			return index.FindTopDocuments(std::execution::seq, raw_query,
+					document_predicate, statistics_, max_result_count);
+		}));
+	}
+	// The tasks refer to the arguments, so all of them have to finish before
+	// an exception of any is rethrown
+	for (const auto &documents : shard_documents) {
+		documents.wait();
+	}
+	TopDocuments top_documents(max_result_count);
+	for (auto &documents : shard_documents) {
+		for (const Document &document : documents.get()) {
+			top_documents.Add(document);
+		}
+	}
+	return top_documents.Extract();
+}
@@ -0,0 +1,33 @@
+#include "string_arena.h"
+#include <algorithm>
+#include <cstring>
+
+StringArena::StringArena(size_t chunk_size) :
+		chunk_size_(chunk_size) {
+}
+
+std::string_view StringArena::Store(std::string_view text) {
+	if (text.empty()) {
+		return {};
+	}
+	if (chunks_.empty()
+			|| chunks_.back().capacity - chunks_.back().size < text.size()) {
+		const size_t capacity = std::max(chunk_size_, text.size());
+		chunks_.push_back( { std::make_unique<char[]>(capacity), capacity, 0 });
+		reserved_bytes_ += capacity;
+	}
+	Chunk &chunk = chunks_.back();
+	char *dst = chunk.data.get() + chunk.size;
+	std::memcpy(dst, text.data(), text.size());
+	chunk.size += text.size();
+	used_bytes_ += text.size();
+	return {dst, text.size()};
+}
+
+size_t StringArena::GetUsedBytes() const {
+	return used_bytes_;
+}
+
+size_t StringArena::GetReservedBytes() const {
+	return reserved_bytes_;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Append-only storage for strings. Memory is allocated in chunks which are
+// never moved or reallocated, so views returned by Store stay valid for the
+// whole lifetime of the arena.
+class StringArena {
+public:
+	static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+	explicit StringArena(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+	std::string_view Store(std::string_view text);
+
+	// Bytes taken by stored strings
+	size_t GetUsedBytes() const;
+
+	// Bytes allocated for chunks, including their unused tails
+	size_t GetReservedBytes() const;
+
+private:
+	struct Chunk {
+		std::unique_ptr<char[]> data;
+		size_t capacity;
+		size_t size;
+	};
+
+	size_t chunk_size_;
+	std::vector<Chunk> chunks_;
+	size_t used_bytes_ = 0;
+	size_t reserved_bytes_ = 0;
+};
@@ -2,6 +2,12 @@
 #include <string>
 #include <iostream>
 #include <vector>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_TOKENIZER
+#endif
 
 using namespace std;
 
@@ -24,3 +30,135 @@ vector<string_view> SplitIntoWords(string_view str) {
 	return result;
 }
 
+namespace {
+bool IsControl(char c) {
+	return static_cast<unsigned char>(c) < ' ';
+}
+
+// Appends the whole word around the control character at position pos
+bool AddInvalidWord(string_view text, size_t pos, vector<string_view> &words) {
+	const size_t begin = text.find_last_of(' ', pos);
+	const size_t end = text.find(' ', pos);
+	const size_t word_begin = begin == text.npos ? 0 : begin + 1;
+	words.push_back(text.substr(word_begin,
+			end == text.npos ? text.npos : end - word_begin));
+	return false;
+}
+
+// Scans text from pos on, continuing the word which starts at word_begin, or
+// no word if word_begin is npos
+bool ScanScalar(string_view text, size_t pos, size_t word_begin,
+		vector<string_view> &words) {
+	for (; pos < text.size(); ++pos) {
+		const char c = text[pos];
+		if (c == ' ') {
+			if (word_begin != text.npos) {
+				words.push_back(text.substr(word_begin, pos - word_begin));
+				word_begin = text.npos;
+			}
+		} else {
+			if (IsControl(c)) {
+				return AddInvalidWord(text, pos, words);
+			}
+			if (word_begin == text.npos) {
+				word_begin = pos;
+			}
+		}
+	}
+	if (word_begin != text.npos) {
+		words.push_back(text.substr(word_begin));
+	}
+	return true;
+}
+
+// Turns per-byte space masks of a block starting at pos into words. A bit
+// of changes is set where a byte differs from the previous one in being a
+// space, i.e. where a word starts or ends
+void AddBlockWords(string_view text, size_t pos, uint64_t spaces,
+		uint64_t changes, size_t &word_begin, vector<string_view> &words) {
+	while (changes != 0) {
+		const int bit = __builtin_ctzll(changes);
+		if ((spaces >> bit) & 1) {
+			words.push_back(text.substr(word_begin, pos + bit - word_begin));
+			word_begin = text.npos;
+		} else {
+			word_begin = pos + bit;
+		}
+		changes &= changes - 1;
+	}
+}
+
+#ifdef SIMD_TOKENIZER
+__attribute__((target("sse2")))
+bool SplitIntoWordsSse2(string_view text, vector<string_view> &words) {
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i max_control = _mm_set1_epi8(' ' - 1);
+	size_t word_begin = text.npos;
+	uint64_t previous_is_space = 1;
+	size_t pos = 0;
+	for (; pos + 16 <= text.size(); pos += 16) {
+		const __m128i block = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(text.data() + pos));
+		const uint64_t controls = _mm_movemask_epi8(
+				_mm_cmpeq_epi8(_mm_min_epu8(block, max_control), block));
+		if (controls != 0) {
+			return AddInvalidWord(text, pos + __builtin_ctzll(controls), words);
+		}
+		const uint64_t spaces = _mm_movemask_epi8(_mm_cmpeq_epi8(block, space));
+		const uint64_t changes = (spaces ^ ((spaces << 1) | previous_is_space))
+				& 0xFFFF;
+		AddBlockWords(text, pos, spaces, changes, word_begin, words);
+		previous_is_space = (spaces >> 15) & 1;
+	}
+	return ScanScalar(text, pos, word_begin, words);
+}
+
+__attribute__((target("avx2")))
+bool SplitIntoWordsAvx2(string_view text, vector<string_view> &words) {
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i max_control = _mm256_set1_epi8(' ' - 1);
+	size_t word_begin = text.npos;
+	uint64_t previous_is_space = 1;
+	size_t pos = 0;
+	for (; pos + 32 <= text.size(); pos += 32) {
+		const __m256i block = _mm256_loadu_si256(
+				reinterpret_cast<const __m256i*>(text.data() + pos));
+		const uint64_t controls = static_cast<uint32_t>(_mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(_mm256_min_epu8(block, max_control), block)));
+		if (controls != 0) {
+			return AddInvalidWord(text, pos + __builtin_ctzll(controls), words);
+		}
+		const uint64_t spaces = static_cast<uint32_t>(_mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(block, space)));
+		const uint64_t changes = (spaces ^ ((spaces << 1) | previous_is_space))
+				& 0xFFFFFFFF;
+		AddBlockWords(text, pos, spaces, changes, word_begin, words);
+		previous_is_space = (spaces >> 31) & 1;
+	}
+	return ScanScalar(text, pos, word_begin, words);
+}
+#endif
+
+using SplitFunction = bool (*)(string_view, vector<string_view>&);
+
+SplitFunction ChooseSplitFunction() {
+#ifdef SIMD_TOKENIZER
+	if (__builtin_cpu_supports("avx2")) {
+		return SplitIntoWordsAvx2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return SplitIntoWordsSse2;
+	}
+#endif
+	return SplitIntoWordsScalar;
+}
+}
+
+bool SplitIntoWordsScalar(string_view text, vector<string_view> &words) {
+	return ScanScalar(text, 0, text.npos, words);
+}
+
+bool SplitIntoWords(string_view text, vector<string_view> &words) {
+	static const SplitFunction split = ChooseSplitFunction();
+	return split(text, words);
+}
@@ -6,6 +6,17 @@
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
+// Splits text by spaces and checks the words for control characters in the
+// same pass. Words are appended to the caller's buffer, which may be reused
+// between calls. Returns false if a control character is found; the word
+// containing it is then the last one in the buffer. Uses AVX2 or SSE2 when the
+// CPU supports them.
+bool SplitIntoWords(std::string_view text, std::vector<std::string_view> &words);
+
+// Portable version of the above, used on CPUs without SIMD support
+bool SplitIntoWordsScalar(std::string_view text,
+		std::vector<std::string_view> &words);
+
 template<typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer &strings) {
 	std::set<std::string, std::less<>> non_empty_strings;
@@ -0,0 +1,38 @@
+#include "term_dictionary.h"
+
+TermId TermDictionary::Intern(std::string_view word) {
+	const auto it = term_ids_.find(word);
+	if (it != term_ids_.end()) {
+		return it->second;
+	}
+	const TermId term_id = terms_.size();
+	const std::string_view stored_word = arena_.Store(word);
+	terms_.push_back(stored_word);
+	term_ids_.emplace(stored_word, term_id);
+	return term_id;
+}
+
+TermId TermDictionary::Find(std::string_view word) const {
+	const auto it = term_ids_.find(word);
+	if (it == term_ids_.end()) {
+		return NO_TERM;
+	}
+	return it->second;
+}
+
+std::string_view TermDictionary::GetTerm(TermId term_id) const {
+	return terms_[term_id];
+}
+
+size_t TermDictionary::size() const {
+	return terms_.size();
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+	const size_t hash_node_bytes = sizeof(void*)
+			+ sizeof(std::pair<const std::string_view, TermId>) + sizeof(size_t);
+	return arena_.GetReservedBytes()
+			+ terms_.capacity() * sizeof(std::string_view)
+			+ term_ids_.bucket_count() * sizeof(void*)
+			+ term_ids_.size() * hash_node_bytes;
+}
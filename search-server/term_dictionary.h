@@ -0,0 +1,30 @@
+#pragma once
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "string_arena.h"
+
+using TermId = int;
+
+// Maps every distinct word to a dense integer id. Words are copied once into
+// the dictionary's own arena, and lookups by std::string_view never allocate.
+class TermDictionary {
+public:
+	static constexpr TermId NO_TERM = -1;
+
+	TermId Intern(std::string_view word);
+
+	TermId Find(std::string_view word) const;
+
+	std::string_view GetTerm(TermId term_id) const;
+
+	size_t size() const;
+
+	// Approximate heap footprint of the arena, the id table and the hash index
+	size_t GetMemoryUsage() const;
+
+private:
+	StringArena arena_;
+	std::vector<std::string_view> terms_;
+	std::unordered_map<std::string_view, TermId> term_ids_;
+};
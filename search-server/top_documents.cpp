@@ -0,0 +1,66 @@
+#include "top_documents.h"
+#include <algorithm>
+#include <vector>
+
+TopDocuments::TopDocuments(size_t max_count) :
+		max_count_(max_count) {
+	heap_.reserve(max_count);
+}
+
+void TopDocuments::Add(const Document &document) {
+	if (heap_.size() < max_count_) {
+		heap_.push_back(document);
+		std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	} else if (max_count_ > 0 && IsMoreRelevant(document, heap_.front())) {
+		std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+		heap_.back() = document;
+		std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	}
+}
+
+void TopDocuments::Merge(const TopDocuments &other) {
+	for (const Document &document : other.heap_) {
+		Add(document);
+	}
+}
+
+const Document& TopDocuments::GetWorst() const {
+	return heap_.front();
+}
+
+double TopDocuments::GetMinRelevance() const {
+	return heap_.front().relevance;
+}
+
+bool TopDocuments::IsFull() const {
+	return heap_.size() == max_count_;
+}
+
+std::vector<Document> TopDocuments::Extract() {
+	std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	return std::move(heap_);
+}
+
+void TopDocuments::ExtractTo(std::vector<Document> &result) {
+	std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	result.assign(heap_.begin(), heap_.end());
+	heap_.clear();
+}
+
+void TopDocuments::Reset(size_t max_count) {
+	max_count_ = max_count;
+	heap_.clear();
+	heap_.reserve(max_count);
+}
+
+std::vector<Document> SelectTopDocuments(std::vector<Document> documents,
+		size_t max_count) {
+	if (documents.size() <= max_count) {
+		std::sort(documents.begin(), documents.end(), IsMoreRelevant);
+		return documents;
+	}
+	std::partial_sort(documents.begin(), documents.begin() + max_count,
+			documents.end(), IsMoreRelevant);
+	documents.resize(max_count);
+	return documents;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <algorithm>
+#include <execution>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+#include "document.h"
+
+// Keeps the max_count most relevant documents seen so far. Documents are held
+// in a heap with the least relevant one on top, so adding a document costs
+// O(log max_count) and nothing beyond max_count is ever stored.
+class TopDocuments {
+public:
+	explicit TopDocuments(size_t max_count);
+
+	void Add(const Document &document);
+
+	void Merge(const TopDocuments &other);
+
+	// Least relevant of the kept documents. Valid only when IsFull()
+	const Document& GetWorst() const;
+
+	// Lowest relevance among the kept documents, which is the one of
+	// GetWorst(). Valid only when IsFull() and max_count > 0
+	double GetMinRelevance() const;
+
+	bool IsFull() const;
+
+	// Returns kept documents ordered from the most relevant one
+	std::vector<Document> Extract();
+
+	// Same as Extract, but copies the documents to result and keeps the
+	// storage for the next use after Reset
+	void ExtractTo(std::vector<Document> &result);
+
+	// Drops kept documents and starts keeping up to max_count new ones
+	void Reset(size_t max_count);
+
+private:
+	size_t max_count_;
+	std::vector<Document> heap_;
+};
+
+std::vector<Document> SelectTopDocuments(std::vector<Document> documents,
+		size_t max_count);
+
+// The parallel version splits the documents into chunk_count chunks, selects
+// top documents of every chunk independently and merges the per-chunk
+// selections
+template<typename ExecutionPolicy>
+std::vector<Document> SelectTopDocuments(const ExecutionPolicy &policy,
+		std::vector<Document> documents, size_t max_count,
+		size_t chunk_count) {
+	if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>,
+			std::execution::sequenced_policy>) {
+		return SelectTopDocuments(std::move(documents), max_count);
+	} else {
+		chunk_count = std::max<size_t>(1, chunk_count);
+		const size_t chunk_size = (documents.size() + chunk_count - 1)
+				/ chunk_count;
+		std::vector<TopDocuments> chunk_tops(chunk_count,
+				TopDocuments(max_count));
+		std::vector<size_t> chunk_indexes(chunk_count);
+		for (size_t i = 0; i < chunk_count; ++i) {
+			chunk_indexes[i] = i;
+		}
+		std::for_each(policy, chunk_indexes.begin(), chunk_indexes.end(),
+				[&](size_t chunk) {
+					const size_t begin = std::min(documents.size(),
+							chunk * chunk_size);
+					const size_t end = std::min(documents.size(),
+							begin + chunk_size);
+					for (size_t i = begin; i < end; ++i) {
+						chunk_tops[chunk].Add(documents[i]);
+					}
+				});
+		for (size_t i = 1; i < chunk_count; ++i) {
+			chunk_tops[0].Merge(chunk_tops[i]);
+		}
+		return chunk_tops[0].Extract();
+	}
+}
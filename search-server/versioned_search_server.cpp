@@ -0,0 +1,91 @@
+#include "versioned_search_server.h"
+#include <atomic>
+#include <utility>
+
+VersionedSearchServer::VersionedSearchServer(
+		const std::string &stop_words_text) :
+		VersionedSearchServer(std::string_view(stop_words_text)) {
+}
+
+VersionedSearchServer::VersionedSearchServer(std::string_view stop_words_text) :
+		VersionedSearchServer(SplitIntoWords(stop_words_text)) {
+}
+
+std::shared_ptr<const SearchServer> VersionedSearchServer::GetSnapshot() const {
+	return std::atomic_load(&current_);
+}
+
+void VersionedSearchServer::AddDocument(int document_id,
+		std::string_view document, DocumentStatus status,
+		const std::vector<int> &ratings) {
+	Apply([document_id, text = std::string(document), status, ratings](
+			SearchServer &search_server) {
+		search_server.AddDocument(document_id, text, status, ratings);
+	});
+}
+
+void VersionedSearchServer::AddDocuments(
+		const std::vector<NewDocument> &documents) {
+	// The change outlives the call, so it keeps its own copy of the texts
+	auto texts = std::make_shared<std::vector<std::string>>();
+	auto owned_documents = std::make_shared<std::vector<NewDocument>>(
+			documents);
+	texts->reserve(documents.size());
+	for (NewDocument &document : *owned_documents) {
+		texts->emplace_back(document.text);
+		document.text = texts->back();
+	}
+	Apply([texts, owned_documents](SearchServer &search_server) {
+		search_server.AddDocuments(std::execution::par, *owned_documents);
+	});
+}
+
+void VersionedSearchServer::RemoveDocument(int document_id) {
+	Apply([document_id](SearchServer &search_server) {
+		search_server.RemoveDocument(document_id);
+	});
+}
+
+void VersionedSearchServer::Apply(Change change) {
+	std::shared_ptr<const SearchServer> previous;
+	{
+		std::unique_lock lock(instances_->mutex);
+		instances_->standby_released.wait(lock, [this] {
+			return instances_->standby != nullptr;
+		});
+		SearchServer *server = instances_->standby;
+		// Either throws leaving the standby untouched, or succeeds
+		change(*server);
+		instances_->standby = nullptr;
+		instances_->current = server;
+		instances_->pending_changes.push_back(std::move(change));
+		previous = std::atomic_exchange(&current_,
+				Publish(instances_, server));
+	}
+	// Without readers the previous version is released here, which takes
+	// the mutex
+	previous.reset();
+}
+
+std::shared_ptr<const SearchServer> VersionedSearchServer::Publish(
+		const std::shared_ptr<Instances> &instances, SearchServer *server) {
+	return std::shared_ptr<const SearchServer>(server,
+			[instances, server](const SearchServer*) {
+				instances->Release(server);
+			});
+}
+
+void VersionedSearchServer::Instances::Release(SearchServer *server) {
+	std::lock_guard guard(mutex);
+	// The current version is released only by the destructor of the
+	// VersionedSearchServer, and it is up to date
+	if (server == current) {
+		return;
+	}
+	for (const Change &change : pending_changes) {
+		change(*server);
+	}
+	pending_changes.clear();
+	standby = server;
+	standby_released.notify_one();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "search_server.h"
+
+// SearchServer that can be queried while documents are added and removed.
+// Readers pin the current immutable version with GetSnapshot and never block.
+// Two instances are kept: a change is applied to the one no reader can
+// reach, which is then published atomically. When the last reader releases
+// the previous version, the release replays the changes it missed, and the
+// instance becomes the target of the next change. So every change is
+// applied twice, but the whole index is never copied. A writer waits only
+// when a reader still holds the version before the current one.
+class VersionedSearchServer {
+public:
+	template<typename StringContainer>
+	explicit VersionedSearchServer(const StringContainer &stop_words);
+
+	explicit VersionedSearchServer(const std::string &stop_words_text);
+
+	explicit VersionedSearchServer(std::string_view stop_words_text);
+
+	// The returned version stays valid and unchanged while it is held
+	std::shared_ptr<const SearchServer> GetSnapshot() const;
+
+	void AddDocument(int document_id, std::string_view document,
+			DocumentStatus status, const std::vector<int> &ratings);
+
+	void AddDocuments(const std::vector<NewDocument> &documents);
+
+	void RemoveDocument(int document_id);
+
+private:
+	using Change = std::function<void(SearchServer&)>;
+
+	// Shared with the published versions, so a version released after the
+	// VersionedSearchServer is gone still finds its instance
+	struct Instances {
+		std::unique_ptr<SearchServer> servers[2];
+		// Guards the members below and serializes writers
+		std::mutex mutex;
+		std::condition_variable standby_released;
+		// The instance of the current version
+		SearchServer *current = nullptr;
+		// The instance not pinned by any reader and up to date with the
+		// current one, or nullptr while the previous version is held
+		SearchServer *standby = nullptr;
+		// Changes already published and not yet applied to the other instance
+		std::vector<Change> pending_changes;
+
+		// Called when the last holder of the version of server lets it go
+		void Release(SearchServer *server);
+	};
+
+	void Apply(Change change);
+	static std::shared_ptr<const SearchServer> Publish(
+			const std::shared_ptr<Instances> &instances, SearchServer *server);
+
+	std::shared_ptr<Instances> instances_;
+	std::shared_ptr<const SearchServer> current_;
+};
+
+template<typename StringContainer>
+VersionedSearchServer::VersionedSearchServer(const StringContainer &stop_words) :
+		instances_(std::make_shared<Instances>()) {
+	for (auto &server : instances_->servers) {
+		server = std::make_unique<SearchServer>(stop_words);
+	}
+	instances_->current = instances_->servers[0].get();
+	instances_->standby = instances_->servers[1].get();
+	current_ = Publish(instances_, instances_->servers[0].get());
+}
@@ -0,0 +1,54 @@
+#include "word_frequencies.h"
+#include <algorithm>
+#include <stdexcept>
+
+WordFrequencies::WordFrequencies(const TermDictionary &dictionary,
+		const TermId *term_ids, const int *term_counts, size_t size,
+		double inv_word_count) {
+	words_.reserve(size);
+	for (size_t i = 0; i < size; ++i) {
+		words_.emplace_back(dictionary.GetTerm(term_ids[i]),
+				term_counts[i] * inv_word_count);
+	}
+	// The forward index is ordered by term id
+	std::sort(words_.begin(), words_.end(),
+			[](const value_type &lhs, const value_type &rhs) {
+				return lhs.first < rhs.first;
+			});
+}
+
+WordFrequencies::Iterator WordFrequencies::begin() const {
+	return words_.begin();
+}
+
+WordFrequencies::Iterator WordFrequencies::end() const {
+	return words_.end();
+}
+
+size_t WordFrequencies::size() const {
+	return words_.size();
+}
+
+bool WordFrequencies::empty() const {
+	return words_.empty();
+}
+
+size_t WordFrequencies::count(std::string_view word) const {
+	return Find(word) == end() ? 0 : 1;
+}
+
+double WordFrequencies::at(std::string_view word) const {
+	const Iterator it = Find(word);
+	if (it == end()) {
+		throw std::out_of_range("Document does not contain the word");
+	}
+	return it->second;
+}
+
+WordFrequencies::Iterator WordFrequencies::Find(std::string_view word) const {
+	const Iterator it = std::lower_bound(begin(), end(), word,
+			[](const value_type &lhs, std::string_view rhs) {
+				return lhs.first < rhs;
+			});
+	return it != end() && it->first == word ? it : end();
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "term_dictionary.h"
+
+// Words of a document with their term frequencies, in the order of words like
+// a std::map<std::string_view, double>. It is built from the forward index of
+// SearchServer on request: only the pairs are stored, the words point into
+// the term dictionary. Iterators and references stay valid while the object
+// is alive, and words stay valid until the index changes.
+class WordFrequencies {
+public:
+	using value_type = std::pair<std::string_view, double>;
+	using Iterator = std::vector<value_type>::const_iterator;
+
+	WordFrequencies() = default;
+
+	WordFrequencies(const TermDictionary &dictionary, const TermId *term_ids,
+			const int *term_counts, size_t size, double inv_word_count);
+
+	Iterator begin() const;
+	Iterator end() const;
+
+	size_t size() const;
+	bool empty() const;
+
+	size_t count(std::string_view word) const;
+
+	// Throws out_of_range if the document does not contain the word
+	double at(std::string_view word) const;
+
+private:
+	std::vector<value_type> words_;
+
+	// The pair of the word, or end() if it is missing
+	Iterator Find(std::string_view word) const;
+};